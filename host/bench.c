@@ -0,0 +1,487 @@
+// Receive-decode-render benchmark on the simulated MCP2515.
+//
+//   bench [-s speed] [-a] [-d seconds] [-b kbit] [-v] [candump.log]
+//
+// Replays a candump log (or synthetic traffic from the signal DB when no
+// log is given) into the simulator at real speed, speed x faster, or with
+// -s 0 as fast as the chip has a free RX buffer. The same path as the
+// target main loop runs: INT service, DMA-style SPI reads, RX ring,
+// stats, decode/dispatch and a compositor repaint into a memory surface
+// once per display frame. The driver starts with bitrate detection, as on
+// the target, against a simulated bus running at -b kbit/s.
+
+#include "sim_mcp2515.h"
+#include "mcp2515.h"
+#include "can_ring.h"
+#include "can_db.h"
+#include "can_dispatch.h"
+#include "can_stats.h"
+#include "compositor.h"
+#include "framebuffer.h"
+#include "gauges.h"
+#include "timer.h"
+#include "dma.h"
+#include "spi.h"
+#include "fmt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+uint64_t host_now_ns(void);
+
+#define SCREEN_W    800
+#define SCREEN_H    480
+#define FRAME_NS    16667000u
+
+// ------------------------------------------------------------
+// Input: candump logs or synthetic traffic
+// ------------------------------------------------------------
+
+typedef struct {
+    uint64_t ts_us;             // relative to the first frame
+    can_frame_t frame;
+} log_entry_t;
+
+static log_entry_t *entries;
+static size_t num_entries, cap_entries;
+
+static void add_entry(uint64_t ts_us, const can_frame_t *f) {
+    if (num_entries == cap_entries) {
+        cap_entries = cap_entries ? cap_entries * 2 : 4096;
+        entries = realloc(entries, cap_entries * sizeof(*entries));
+        if (!entries) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    entries[num_entries].ts_us = ts_us;
+    entries[num_entries].frame = *f;
+    num_entries++;
+}
+
+static int hexval(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// "(sec.usec) iface ID#DATA" (candump -l) or
+// "(sec.usec) iface ID [n] B0 B1 .." (candump -ta); the timestamp is optional
+static bool parse_candump(const char *s, uint64_t *ts_us, can_frame_t *f) {
+    uint64_t sec = 0, usec = 0;
+    memset(f, 0, sizeof(*f));
+
+    while (*s == ' ' || *s == '\t') s++;
+    if (*s == '(') {
+        char *end;
+        sec = strtoull(s + 1, &end, 10);
+        if (*end == '.')
+            usec = strtoull(end + 1, &end, 10);
+        s = strchr(end, ')');
+        if (!s)
+            return false;
+        s++;
+    }
+    *ts_us = sec * 1000000u + usec;
+
+    // Interface name
+    while (*s == ' ' || *s == '\t') s++;
+    while (*s && *s != ' ' && *s != '\t') s++;
+    while (*s == ' ' || *s == '\t') s++;
+
+    int digits = 0;
+    uint32_t id = 0;
+    while (hexval(*s) >= 0) {
+        id = (id << 4) | hexval(*s++);
+        digits++;
+    }
+    if (digits == 0)
+        return false;
+    f->id = digits > 3 ? (id & CAN_EFF_MASK) | CAN_EFF_FLAG : id;
+
+    if (*s == '#') {
+        s++;
+        if (*s == '#' || *s == 'R')
+            return false;               // CAN FD or remote frame
+        while (f->dlc < 8 && hexval(s[0]) >= 0 && hexval(s[1]) >= 0) {
+            f->data[f->dlc++] = (hexval(s[0]) << 4) | hexval(s[1]);
+            s += 2;
+            if (*s == '.') s++;
+        }
+        return true;
+    }
+
+    while (*s == ' ') s++;
+    if (*s != '[')
+        return false;
+    int n = atoi(s + 1);
+    s = strchr(s, ']');
+    if (!s || n < 0 || n > 8)
+        return false;
+    s++;
+    for (int i = 0; i < n; i++) {
+        while (*s == ' ') s++;
+        if (hexval(s[0]) < 0 || hexval(s[1]) < 0)
+            return false;
+        f->data[i] = (hexval(s[0]) << 4) | hexval(s[1]);
+        s += 2;
+    }
+    f->dlc = n;
+    return true;
+}
+
+static void load_candump(const char *path) {
+    FILE *fp = fopen(path, "r");
+    char line[256];
+    uint64_t first = 0;
+
+    if (!fp) {
+        perror(path);
+        exit(1);
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        uint64_t ts;
+        can_frame_t f;
+        if (!parse_candump(line, &ts, &f))
+            continue;
+        if (num_entries == 0)
+            first = ts;
+        add_entry(ts >= first ? ts - first : 0, &f);
+    }
+    fclose(fp);
+}
+
+// Every DB message every 10 ms plus one ID outside the DB, with a
+// sweeping EEC1 engine speed so the gauge moves
+static void synth_traffic(uint32_t seconds) {
+    for (uint64_t t = 0; t < (uint64_t)seconds * 1000000u; t += 10000) {
+        for (uint32_t m = 0; m < CAN_DB_NUM_MESSAGES; m++) {
+            can_frame_t f = { can_db_messages[m].id, can_db_messages[m].dlc, { 0 } };
+            if (f.id == CAN_MSG_EEC1) {
+                uint32_t raw = (uint32_t)((t / 1000) % 32000);
+                f.data[0] = raw >> 8;
+                f.data[1] = raw & 0xFF;
+            }
+            add_entry(t + m * 100, &f);
+        }
+        can_frame_t other = { 0x7DF, 8, { 2, 1, 0x0C } };
+        add_entry(t + 900, &other);
+    }
+}
+
+// ------------------------------------------------------------
+// Measurement
+// ------------------------------------------------------------
+
+typedef struct {
+    const char *name;
+    uint64_t count, sum_ns, max_ns;
+} stage_t;
+
+static stage_t st_isr = { .name = "INT edge -> ISR stamp" };
+static stage_t st_deq = { .name = "ISR stamp -> dequeue" };
+static stage_t st_dec = { .name = "stats + decode + dispatch" };
+static stage_t st_pix = { .name = "dequeue -> pixels flipped" };
+
+static void stage_add(stage_t *s, int64_t ns) {
+    if (ns < 0)
+        ns = 0;
+    s->count++;
+    s->sum_ns += ns;
+    if ((uint64_t)ns > s->max_ns)
+        s->max_ns = ns;
+}
+
+static void stage_print(const stage_t *s) {
+    printf("  %-28s %10.2f %10.2f\n", s->name,
+           s->count ? s->sum_ns / 1000.0 / s->count : 0.0, s->max_ns / 1000.0);
+}
+
+// Frames inside the simulated chip or driver, in bus order, so the
+// consumer can find when each one was put on the bus
+#define INFLIGHT 1024
+static struct { uint32_t id; uint64_t ns; } inflight[INFLIGHT];
+static uint32_t if_head, if_tail;
+
+static void inflight_push(uint32_t id, uint64_t ns) {
+    inflight[if_head % INFLIGHT].id = id;
+    inflight[if_head % INFLIGHT].ns = ns;
+    if_head++;
+}
+
+static bool inflight_pop(uint32_t id, uint64_t *ns) {
+    // Normally the head; rollover can reorder within the two RX buffers
+    for (uint32_t i = if_tail; i != if_head && i - if_tail < 4; i++) {
+        if (inflight[i % INFLIGHT].id == id) {
+            *ns = inflight[i % INFLIGHT].ns;
+            inflight[i % INFLIGHT] = inflight[if_tail % INFLIGHT];
+            if_tail++;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ------------------------------------------------------------
+// Screen: RPM gauge plus a frame log, as on target
+// ------------------------------------------------------------
+
+#define LOG_LINES   30
+#define LOG_X       10
+#define LOG_Y       10
+#define LOG_LINE_H  12
+#define LOG_W       (48 * 8)
+
+static char log_lines[LOG_LINES][64];
+static int log_head;
+static widget_t log_widget;
+
+static void log_frame(const can_frame_t *f) {
+    char *line = log_lines[log_head];
+    int n = 0;
+
+    if (f->id & CAN_EFF_FLAG)
+        n += fmt_u32_hex(line + n, f->id & CAN_EFF_MASK, 8);
+    else
+        n += fmt_u32_hex(line + n, f->id, 3);
+    line[n++] = ' ';
+    for (uint8_t i = 0; i < f->dlc; i++) {
+        n += fmt_u32_hex(line + n, f->data[i], 2);
+        line[n++] = ' ';
+    }
+    line[n] = 0;
+
+    fb_rect_t r = { LOG_X, LOG_Y + log_head * LOG_LINE_H, LOG_W, LOG_LINE_H };
+    comp_damage(&r);
+    log_head = (log_head + 1) % LOG_LINES;
+}
+
+static void draw_log(framebuffer_t *fb, const fb_rect_t *clip, void *ctx) {
+    int first = (clip->y - LOG_Y) / LOG_LINE_H;
+    int last = (clip->y + clip->h - 1 - LOG_Y) / LOG_LINE_H;
+    if (first < 0) first = 0;
+    if (last >= LOG_LINES) last = LOG_LINES - 1;
+
+    for (int i = first; i <= last; i++) {
+        int32_t y = LOG_Y + i * LOG_LINE_H;
+        int32_t n = (int32_t)strlen(log_lines[i]);
+        fb_draw_text_bg(fb, LOG_X, y, log_lines[i], 0x00FFFFFF, 0x00000000);
+        fb_fill_rect(fb, LOG_X + n * 8, y, LOG_W - n * 8, LOG_LINE_H, 0x00000000);
+    }
+}
+
+static void on_eec1(const can_frame_t *f, const can_msg_def_t *m, void *ctx) {
+    rpm_gauge_set(ctx, sig_values[SIG_EEC1_ENGINE_SPEED] / SIG_SCALE);
+}
+
+// ------------------------------------------------------------
+// Main
+// ------------------------------------------------------------
+
+static void usage(void) {
+    fprintf(stderr, "usage: bench [-s speed] [-a] [-d seconds] [-b kbit] [-v] [candump.log]\n"
+                    "  -s  replay speed factor, 0 = as fast as the chip drains (default 1)\n"
+                    "  -a  accept all IDs instead of programming filters from the DB\n"
+                    "  -d  length of synthetic traffic when no log is given (default 5)\n"
+                    "  -b  bitrate of the simulated bus in kbit/s (default 500)\n"
+                    "  -v  dump per-ID stats at the end\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    double speed = 1.0;
+    bool accept_all = false, verbose = false;
+    uint32_t synth_s = 5;
+    uint32_t bus_kbit = 500;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:ad:b:v")) != -1) {
+        switch (opt) {
+        case 's': speed = atof(optarg); break;
+        case 'a': accept_all = true; break;
+        case 'd': synth_s = (uint32_t)atoi(optarg); break;
+        case 'b': bus_kbit = (uint32_t)atoi(optarg); break;
+        case 'v': verbose = true; break;
+        default:  usage();
+        }
+    }
+
+    if (optind < argc)
+        load_candump(argv[optind]);
+    else
+        synth_traffic(synth_s);
+    if (num_entries == 0) {
+        fprintf(stderr, "no frames to replay\n");
+        return 1;
+    }
+
+    timer_init();
+    sim_mcp_set_bus_bitrate(bus_kbit * 1000);
+    if (!mcp2515_init(MCP_XTAL_16MHZ, MCP_BITRATE_500K, MCP2515_AUTOBAUD))
+        return 1;
+
+    if (!accept_all) {
+        uint32_t ids[CAN_DB_NUM_MESSAGES];
+        for (uint32_t i = 0; i < CAN_DB_NUM_MESSAGES; i++)
+            ids[i] = can_db_messages[i].id;
+        mcp2515_set_filters(ids, CAN_DB_NUM_MESSAGES);
+    }
+    can_stats_init(mcp2515_bitrate());
+
+    static uint32_t pixels[SCREEN_W * SCREEN_H];
+    framebuffer_t fb;
+    fb_init_surface(&fb, pixels, SCREEN_W, SCREEN_H);
+    comp_init(&fb, 0x00000000);
+
+    log_widget.bounds = (fb_rect_t){ LOG_X, LOG_Y, LOG_W, LOG_LINES * LOG_LINE_H };
+    log_widget.draw = draw_log;
+    log_widget.opaque = true;
+    comp_add_widget(&log_widget);
+
+    static rpm_gauge_t gauge;
+    if (rpm_gauge_init(&gauge, 600, 240, 150)) {
+        comp_add_widget(&gauge.widget);
+        can_dispatch_register(CAN_MSG_EEC1, on_eec1, &gauge);
+    }
+    comp_flush();
+
+    can_ring_t *ring = mcp2515_rx_ring();
+    size_t next = 0;
+    uint64_t processed = 0, flushes = 0, repainted = 0;
+
+    // Frames dequeued since the last flush
+    uint64_t unflushed = 0, unflushed_sum = 0, unflushed_min = 0;
+
+    uint64_t t0 = host_now_ns();
+    uint64_t last_flush = t0;
+    uint64_t locked_ns = 0, last_offer = 0;
+
+    for (;;) {
+        uint64_t now = host_now_ns();
+
+        // Put due frames on the bus
+        if (speed <= 0) {
+            // Until the bitrate locks, one frame per 100 µs so the search
+            // sees traffic for longer than the whole log takes to flood
+            while (next < num_entries && sim_mcp_rx_room(&entries[next].frame)) {
+                if (!locked_ns) {
+                    if (now - last_offer < 100000)
+                        break;
+                    last_offer = now;
+                }
+                if (sim_mcp_rx(&entries[next].frame) && locked_ns)
+                    inflight_push(entries[next].frame.id, host_now_ns());
+                next++;
+            }
+        } else {
+            while (next < num_entries &&
+                   (double)entries[next].ts_us * 1000.0 / speed <= (double)(now - t0)) {
+                if (sim_mcp_rx(&entries[next].frame) && locked_ns)
+                    inflight_push(entries[next].frame.id, host_now_ns());
+                next++;
+            }
+        }
+
+        if (mcp2515_int_pending())
+            mcp2515_isr();
+        dma_poll();
+        mcp2515_poll(now / 1000);
+
+        if (!locked_ns && mcp2515_bitrate_locked()) {
+            locked_ns = host_now_ns();
+            can_stats_init(mcp2515_bitrate());
+        }
+
+        const can_rx_t *batch;
+        uint32_t n;
+        while ((n = can_ring_peek(ring, &batch)) != 0) {
+            for (uint32_t i = 0; i < n; i++) {
+                const can_frame_t *f = &batch[i].frame;
+                uint64_t deq = host_now_ns();
+                uint64_t wire;
+
+                if (inflight_pop(f->id, &wire))
+                    stage_add(&st_isr, (int64_t)(batch[i].ts * 1000) - (int64_t)wire);
+                stage_add(&st_deq, (int64_t)deq - (int64_t)(batch[i].ts * 1000));
+
+                can_stats_record(f, batch[i].ts);
+                can_dispatch(f);
+                log_frame(f);
+                stage_add(&st_dec, (int64_t)(host_now_ns() - deq));
+
+                if (unflushed == 0 || deq < unflushed_min)
+                    unflushed_min = deq;
+                unflushed++;
+                unflushed_sum += deq;
+                processed++;
+            }
+            can_ring_consume(ring, n);
+        }
+
+        now = host_now_ns();
+        can_stats_tick(now / 1000);
+
+        bool done = next == num_entries && can_ring_count(ring) == 0 &&
+                    sim_mcp_int_level() && !spi_busy();
+
+        if (now - last_flush >= FRAME_NS || done) {
+            repainted += comp_flush();
+            flushes++;
+            last_flush = now;
+
+            uint64_t end = host_now_ns();
+            if (unflushed) {
+                st_pix.count += unflushed;
+                st_pix.sum_ns += end * unflushed - unflushed_sum;
+                if (end - unflushed_min > st_pix.max_ns)
+                    st_pix.max_ns = end - unflushed_min;
+                unflushed = 0;
+                unflushed_sum = 0;
+            }
+        }
+
+        if (done)
+            break;
+    }
+
+    double elapsed = (host_now_ns() - t0) / 1e9;
+    sim_mcp_stats_t sim;
+    sim_mcp_stats(&sim);
+
+    printf("frames: %zu in log, %llu offered, %llu filtered, %llu lost to chip overflow, "
+           "%u lost to ring overflow, %llu processed\n",
+           num_entries, (unsigned long long)sim.offered, (unsigned long long)sim.filtered,
+           (unsigned long long)sim.overflowed, mcp2515_rx_dropped(),
+           (unsigned long long)processed);
+    if (locked_ns)
+        printf("bitrate: %u kbit/s locked after %.1f ms, %llu frames at wrong rates, "
+               "%llu error frames sent\n",
+               sim_mcp_bitrate() / 1000, (locked_ns - t0) / 1e6,
+               (unsigned long long)sim.bad_rate, (unsigned long long)sim.error_frames);
+    else
+        printf("bitrate: not locked, %llu frames at wrong rates\n",
+               (unsigned long long)sim.bad_rate);
+    mcp_err_stats_t err;
+    mcp2515_err_stats(&err);
+    printf("driver: %u RX0OVR + %u RX1OVR + %u ring = %u frames lost, %u msg errors\n",
+           err.rx0_overflow, err.rx1_overflow, err.rx_ring_full, mcp2515_frames_lost(),
+           err.msg_errors);
+    printf("time: %.3f s, %.0f frames/s processed, %.1f SPI bytes and %.1f transactions per frame\n",
+           elapsed, processed / elapsed,
+           processed ? (double)sim.spi_bytes / processed : 0.0,
+           processed ? (double)sim.spi_xfers / processed : 0.0);
+    printf("render: %llu flushes, %.0f pixels per flush\n", (unsigned long long)flushes,
+           flushes ? (double)repainted / flushes : 0.0);
+    printf("latency per frame (us)             avg        max\n");
+    stage_print(&st_isr);
+    stage_print(&st_deq);
+    stage_print(&st_dec);
+    stage_print(&st_pix);
+
+    if (verbose)
+        can_stats_dump();
+    return 0;
+}
@@ -0,0 +1,319 @@
+// src/dma.c and the SPI DMA path in src/spio.c against the fake engine
+// in sim_dma.c: control-block chaining, the TI increment and DREQ/PERMAP
+// fields, and when the completion callback runs.
+//
+//   dmatest
+
+#include "sim_dma.h"
+#include "dma.h"
+#include "spi.h"
+#include "peripherals.h"
+#include <stdio.h>
+#include <string.h>
+
+#define CH          0
+#define DMA_CS(n)   (DMA_BASE + (n) * 0x100)
+
+static int failed;
+
+#define CHECK(cond) do {                                            \
+        if (!(cond)) {                                              \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);  \
+            failed = 1;                                             \
+        }                                                           \
+    } while (0)
+
+static struct {
+    uint32_t calls;
+    uint32_t ch;
+    bool error;
+    void *ctx;
+} done;
+
+static void on_done(uint32_t ch, bool error, void *ctx) {
+    done.calls++;
+    done.ch = ch;
+    done.error = error;
+    done.ctx = ctx;
+}
+
+// ------------------------------------------------------------
+// Memory to memory: three blocks into one destination
+// ------------------------------------------------------------
+
+static uint32_t src[3][8], dst[24];
+static dma_cb_t cbs[3];
+
+static void build_chain(uint32_t inten_mask) {
+    for (uint32_t i = 0; i < 3; i++) {
+        for (uint32_t j = 0; j < 8; j++)
+            src[i][j] = 0x1000 * (i + 1) + j;
+
+        cbs[i].ti = DMA_TI_SRC_INC | DMA_TI_DEST_INC |
+                    ((inten_mask >> i) & 1 ? DMA_TI_INTEN : 0);
+        cbs[i].source_ad = dma_bus_addr(src[i]);
+        cbs[i].dest_ad = dma_bus_addr(&dst[8 * i]);
+        cbs[i].txfr_len = sizeof(src[i]);
+        cbs[i].stride = 0;
+        dma_cb_chain(&cbs[i], i < 2 ? &cbs[i + 1] : 0);
+    }
+    memset(dst, 0, sizeof(dst));
+    memset(&done, 0, sizeof(done));
+}
+
+static bool dst_ok(void) {
+    for (uint32_t i = 0; i < 3; i++) {
+        if (memcmp(&dst[8 * i], src[i], sizeof(src[i])) != 0)
+            return false;
+    }
+    return true;
+}
+
+static void test_chain(void) {
+    sim_dma_stats_t st0, st1;
+    int tag;
+
+    build_chain(1u << 2);
+
+    // Links are bus addresses in the uncached alias, the last one 0
+    CHECK(cbs[0].nextconbk == dma_bus_addr(&cbs[1]));
+    CHECK(cbs[1].nextconbk == dma_bus_addr(&cbs[2]));
+    CHECK(cbs[2].nextconbk == 0);
+    CHECK((cbs[1].nextconbk & 0xF0000000u) == 0xC0000000u);
+
+    sim_dma_stats(CH, &st0);
+    dma_start(CH, cbs, 3, on_done, &tag);
+    CHECK(dma_busy(CH));
+
+    // First block only: no INTEN on it, so nothing to report yet
+    CHECK(sim_dma_step(CH));
+    dma_poll();
+    CHECK(done.calls == 0);
+    CHECK(mmio_read(DMA_CS(CH)) & 1);          // still ACTIVE
+    CHECK(dma_busy(CH));
+
+    sim_dma_run();
+    dma_poll();
+    CHECK(done.calls == 1 && done.ch == CH && !done.error && done.ctx == &tag);
+    CHECK(!dma_busy(CH));
+    CHECK(dst_ok());
+
+    sim_dma_stats(CH, &st1);
+    CHECK(st1.blocks - st0.blocks == 3);
+    CHECK(st1.words - st0.words == 24);
+}
+
+// INTEN on a block mid-chain raises the interrupt with the channel still
+// active: the driver clears it and waits for the end
+static void test_mid_chain_int(void) {
+    build_chain((1u << 0) | (1u << 2));
+    dma_start(CH, cbs, 3, on_done, 0);
+
+    CHECK(sim_dma_step(CH));
+    CHECK(mmio_read(DMA_BASE + 0xFE0) & (1u << CH));
+    dma_poll();
+    CHECK(done.calls == 0);
+    CHECK(!(mmio_read(DMA_BASE + 0xFE0) & (1u << CH)));
+
+    sim_dma_run();
+    dma_poll();
+    CHECK(done.calls == 1 && !done.error);
+    CHECK(dst_ok());
+}
+
+// No INTEN anywhere: never busy, never reported, still runs
+static void test_no_inten(void) {
+    build_chain(0);
+    dma_start(CH, cbs, 3, on_done, 0);
+    CHECK(!dma_busy(CH));
+
+    sim_dma_run();
+    dma_poll();
+    CHECK(done.calls == 0);
+    CHECK(dst_ok());
+}
+
+// A control block off its 32-byte alignment stops the channel with an
+// error, and the callback says so
+static void test_bad_cb(void) {
+    static uint8_t raw[2 * sizeof(dma_cb_t)] __attribute__((aligned(32)));
+    dma_cb_t cb = { 0 };
+    sim_dma_stats_t st0, st1;
+
+    cb.ti = DMA_TI_SRC_INC | DMA_TI_DEST_INC | DMA_TI_INTEN;
+    cb.source_ad = dma_bus_addr(src[0]);
+    cb.dest_ad = dma_bus_addr(dst);
+    cb.txfr_len = 4;
+    memcpy(raw + 8, &cb, sizeof(cb));
+    memset(&done, 0, sizeof(done));
+
+    sim_dma_stats(CH, &st0);
+    dma_start(CH, (dma_cb_t *)(raw + 8), 1, on_done, 0);
+    sim_dma_run();
+    dma_poll();
+
+    sim_dma_stats(CH, &st1);
+    CHECK(st1.errors == st0.errors + 1);
+    CHECK(done.calls == 1 && done.error);
+    CHECK(!dma_busy(CH));
+}
+
+// ------------------------------------------------------------
+// Peripheral side: PERMAP picks the DREQ line, and a peripheral address
+// without the DREQ flag is an unpaced access
+// ------------------------------------------------------------
+
+static uint32_t sink_words[8], sink_count;
+
+static void sink_write(uint32_t w, void *ctx) {
+    if (sink_count < 8)
+        sink_words[sink_count] = w;
+    sink_count++;
+}
+
+static void test_dreq(void) {
+    static const sim_dma_periph_t sink = { 0, sink_write, 0 };
+    sim_dma_stats_t st0, st1;
+
+    sim_dma_attach(3, &sink);
+
+    build_chain(0);
+    cbs[0].ti = DMA_TI_SRC_INC | DMA_TI_DEST_DREQ | DMA_TI_PERMAP(3) | DMA_TI_INTEN;
+    cbs[0].dest_ad = dma_periph_bus_addr(PERIPH_BASE + 0x1000);
+    dma_cb_chain(&cbs[0], 0);
+
+    sink_count = 0;
+    sim_dma_stats(CH, &st0);
+    dma_start(CH, cbs, 1, on_done, 0);
+    sim_dma_run();
+    dma_poll();
+    sim_dma_stats(CH, &st1);
+
+    CHECK(done.calls == 1 && !done.error);
+    CHECK(sink_count == 8 && memcmp(sink_words, src[0], sizeof(src[0])) == 0);
+    CHECK(st1.unpaced == st0.unpaced);
+
+    // Same block without DEST_DREQ: moves, but unpaced
+    cbs[0].ti &= ~DMA_TI_DEST_DREQ;
+    sink_count = 0;
+    dma_start(CH, cbs, 1, on_done, 0);
+    sim_dma_run();
+    dma_poll();
+    sim_dma_stats(CH, &st0);
+    CHECK(st0.unpaced == st1.unpaced + 8);
+
+    // A DREQ line with nothing behind it: the channel stops with an error
+    cbs[0].ti = DMA_TI_SRC_INC | DMA_TI_DEST_DREQ | DMA_TI_PERMAP(9) | DMA_TI_INTEN;
+    memset(&done, 0, sizeof(done));
+    dma_start(CH, cbs, 1, on_done, 0);
+    sim_dma_run();
+    dma_poll();
+    CHECK(done.calls == 1 && done.error);
+}
+
+// ------------------------------------------------------------
+// SPI0 through DREQ 6/7: the TX stream is a DLEN/CS header word and the
+// bytes, and the slave answers each byte with byte ^ 0xA5
+// ------------------------------------------------------------
+
+static struct {
+    bool header;
+    uint32_t dlen, cs;
+    uint32_t sent;
+    uint8_t miso[64];
+    uint32_t head, tail;
+} spi0;
+
+static void spi_tx_write(uint32_t w, void *ctx) {
+    if (!spi0.header) {
+        spi0.header = true;
+        spi0.dlen = w >> 16;
+        spi0.cs = w & 0xFFFF;
+        return;
+    }
+    for (int i = 0; i < 4 && spi0.sent < spi0.dlen; i++, spi0.sent++)
+        spi0.miso[spi0.head++ % 64] = (uint8_t)(w >> (8 * i)) ^ 0xA5;
+}
+
+// RX DREQ: a word once four bytes have come back
+static bool spi_rx_read(uint32_t *w, void *ctx) {
+    if (spi0.head - spi0.tail < 4)
+        return false;
+
+    *w = 0;
+    for (int i = 0; i < 4; i++)
+        *w |= (uint32_t)spi0.miso[spi0.tail++ % 64] << (8 * i);
+    return true;
+}
+
+static struct {
+    uint32_t calls;
+    uint8_t rx[SPI_DMA_MAX];
+    uint32_t len;
+} spi_done;
+
+static void on_spi_done(const uint8_t *rx, uint32_t len, void *ctx) {
+    spi_done.calls++;
+    spi_done.len = len;
+    memcpy(spi_done.rx, rx, len);
+}
+
+static void test_spi(uint32_t len) {
+    uint8_t tx[SPI_DMA_MAX];
+    sim_dma_stats_t tx0, rx0, tx1, rx1;
+
+    for (uint32_t i = 0; i < len; i++)
+        tx[i] = (uint8_t)(0x30 + i);
+
+    memset(&spi0, 0, sizeof(spi0));
+    memset(&spi_done, 0, sizeof(spi_done));
+    sim_dma_stats(DMA_CH_SPI_TX, &tx0);
+    sim_dma_stats(DMA_CH_SPI_RX, &rx0);
+
+    CHECK(spi_xfer_async(tx, len, on_spi_done, 0));
+    CHECK(spi_busy());
+    CHECK(!spi_xfer_async(tx, len, on_spi_done, 0));
+    CHECK(dma_busy(DMA_CH_SPI_RX));
+    CHECK(!dma_busy(DMA_CH_SPI_TX));
+
+    sim_dma_run();
+    CHECK(spi_done.calls == 0);
+    dma_poll();
+
+    sim_dma_stats(DMA_CH_SPI_TX, &tx1);
+    sim_dma_stats(DMA_CH_SPI_RX, &rx1);
+
+    uint32_t padded = (len + 3) & ~3u;
+    CHECK(spi0.header && spi0.dlen == padded && (spi0.cs & (1u << 7)));
+    CHECK(spi_done.calls == 1 && spi_done.len == len);
+    for (uint32_t i = 0; i < len; i++)
+        CHECK(spi_done.rx[i] == (tx[i] ^ 0xA5));
+
+    CHECK(tx1.words - tx0.words == 1 + padded / 4);
+    CHECK(rx1.words - rx0.words == padded / 4);
+    CHECK(tx1.unpaced == tx0.unpaced && rx1.unpaced == rx0.unpaced);
+    CHECK(tx1.errors == tx0.errors && rx1.errors == rx0.errors);
+    CHECK(!spi_busy());
+    CHECK(!dma_busy(DMA_CH_SPI_TX) && !dma_busy(DMA_CH_SPI_RX));
+}
+
+int main(void) {
+    static const sim_dma_periph_t tx = { 0, spi_tx_write, 0 };
+    static const sim_dma_periph_t rx = { spi_rx_read, 0, 0 };
+
+    sim_dma_attach(DMA_DREQ_SPI_TX, &tx);
+    sim_dma_attach(DMA_DREQ_SPI_RX, &rx);
+    spi_init();
+
+    test_chain();
+    test_mid_chain_int();
+    test_no_inten();
+    test_bad_cb();
+    test_dreq();
+    test_spi(13);       // one frame read
+    test_spi(SPI_DMA_MAX);
+    test_spi(1);
+
+    printf("dmatest %s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
@@ -0,0 +1,12 @@
+// Built once per variant with FB_VARIANT naming the table (see the Makefile)
+
+#include "fb_variant.h"
+
+const fb_variant_t FB_VARIANT = {
+    .init_surface = fb_init_surface,
+    .set_clip     = fb_set_clip,
+    .fill_rect    = fb_fill_rect,
+    .copy_rect    = fb_copy_rect,
+    .blit_keyed   = fb_blit_keyed,
+    .draw_text_bg = fb_draw_text_bg,
+};
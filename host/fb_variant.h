@@ -0,0 +1,26 @@
+#pragma once
+#include "framebuffer.h"
+
+/*
+ * The drawing entry points of one build of framebuffer.c and fb_simd.c.
+ * simdtest links two builds side by side, scalar and FB_SIMD; each is
+ * partially linked with only its table left global (see the Makefile).
+ */
+
+typedef struct {
+    void (*init_surface)(framebuffer_t *fb, uint32_t *mem, uint32_t w, uint32_t h);
+    void (*set_clip)(framebuffer_t *fb, const fb_rect_t *r);
+    void (*fill_rect)(framebuffer_t *fb, uint32_t x, uint32_t y,
+                      uint32_t w, uint32_t h, uint32_t color);
+    void (*copy_rect)(framebuffer_t *fb, int32_t dx, int32_t dy,
+                      const framebuffer_t *src, int32_t sx, int32_t sy,
+                      int32_t w, int32_t h);
+    void (*blit_keyed)(framebuffer_t *fb, int32_t dx, int32_t dy,
+                       const framebuffer_t *src, int32_t sx, int32_t sy,
+                       int32_t w, int32_t h, uint32_t key);
+    void (*draw_text_bg)(framebuffer_t *fb, int32_t x, int32_t y, const char *s,
+                         uint32_t fg, uint32_t bg);
+} fb_variant_t;
+
+extern const fb_variant_t fb_scalar;
+extern const fb_variant_t fb_simd;
@@ -0,0 +1,138 @@
+// fb_init() and fb_swap() against the fake property channel
+// (sim_mbox.h): double buffering when the firmware grants the tall
+// virtual screen, the page offset toggling on each flip with the vsync
+// wait after it, drawing landing in the page off screen, and the single
+// buffer fallbacks.
+
+#include "framebuffer.h"
+#include "fb_dlist.h"
+#include "sim_mbox.h"
+#include <stdio.h>
+#include <string.h>
+
+#define W   800
+#define H   480
+
+static int failed;
+
+#define CHECK(cond) do {                                            \
+        if (!(cond)) {                                              \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);  \
+            failed = 1;                                             \
+        }                                                           \
+    } while (0)
+
+static framebuffer_t fb;
+
+static uint32_t pixel(uint32_t page, uint32_t x, uint32_t y) {
+    const uint32_t *p = (const uint32_t *)(sim_mbox_buffer() + (page * H + y) * fb.pitch);
+    return p[x];
+}
+
+static void test_double(void) {
+    sim_mbox_state_t st;
+
+    sim_mbox_max_virtual_height(0);
+    CHECK(fb_init(&fb, W, H, 32));
+    sim_mbox_state(&st);
+
+    CHECK(st.virt_height == 2 * H);
+    CHECK(fb.pitch == W * 4);
+    CHECK(fb.num_pages == 2);
+    CHECK(fb.pages[0] == sim_mbox_buffer());
+    CHECK(fb.pages[1] == fb.pages[0] + H * fb.pitch);
+
+    // Page 0 is on screen, so drawing starts in page 1
+    CHECK(st.y_offset == 0);
+    CHECK(fb.back == 1);
+    CHECK(fb.buf == fb.pages[1]);
+
+    fb_fill_rect(&fb, 10, 20, 4, 4, 0x11111111);
+    CHECK(pixel(1, 10, 20) == 0x11111111);
+    CHECK(pixel(0, 10, 20) == 0);
+
+    // Flip: page 1 goes on screen before the vsync wait, drawing moves
+    // to page 0
+    fb_swap(&fb);
+    sim_mbox_state(&st);
+    CHECK(st.y_offset == H);
+    CHECK(st.vsyncs == 1);
+    CHECK(st.vsync_offset == H);
+    CHECK(fb.back == 0);
+    CHECK(fb.buf == fb.pages[0]);
+
+    fb_fill_rect(&fb, 10, 20, 4, 4, 0x22222222);
+    CHECK(pixel(0, 10, 20) == 0x22222222);
+    CHECK(pixel(1, 10, 20) == 0x11111111);
+
+    // And back
+    fb_swap(&fb);
+    sim_mbox_state(&st);
+    CHECK(st.y_offset == 0);
+    CHECK(st.vsyncs == 2);
+    CHECK(st.vsync_offset == 0);
+    CHECK(fb.back == 1);
+    CHECK(fb.buf == fb.pages[1]);
+
+    // Draws still batched at the flip go to the page going on screen
+    static fb_dlist_t dl;
+    fb_batch_begin(&fb, &dl);
+    fb_fill_rect(&fb, 30, 40, 2, 2, 0x33333333);
+    fb_swap(&fb);
+    sim_mbox_state(&st);
+    CHECK(pixel(1, 30, 40) == 0x33333333);
+    CHECK(pixel(0, 30, 40) == 0);
+    CHECK(st.y_offset == H);
+    CHECK(fb.back == 0);
+    fb_batch_end(&fb);
+
+    // A failed call leaves the offset and the back page alone
+    sim_mbox_fail(true);
+    fb_swap(&fb);
+    sim_mbox_fail(false);
+    sim_mbox_state(&st);
+    CHECK(st.y_offset == H);
+    CHECK(st.vsyncs == 3);
+    CHECK(fb.back == 0);
+    CHECK(fb.buf == fb.pages[0]);
+
+    CHECK(st.unknown == 0);
+    printf("%-8s %s\n", "double", failed ? "FAIL" : "ok");
+}
+
+static void test_single(void) {
+    sim_mbox_state_t st, before;
+    int was_failed = failed;
+
+    failed = 0;
+
+    // Firmware that will not make the virtual screen taller
+    sim_mbox_max_virtual_height(H);
+    CHECK(fb_init(&fb, W, H, 32));
+    sim_mbox_state(&before);
+
+    CHECK(before.virt_height == H);
+    CHECK(fb.num_pages == 1);
+    CHECK(fb.back == 0);
+    CHECK(fb.buf == fb.pages[0]);
+
+    // Nothing to flip: no mailbox traffic, drawing stays put
+    fb_swap(&fb);
+    sim_mbox_state(&st);
+    CHECK(st.calls == before.calls);
+    CHECK(fb.buf == fb.pages[0]);
+
+    // No mailbox at all
+    sim_mbox_fail(true);
+    CHECK(!fb_init(&fb, W, H, 32));
+    sim_mbox_fail(false);
+
+    printf("%-8s %s\n", "single", failed ? "FAIL" : "ok");
+    failed |= was_failed;
+}
+
+int main(void) {
+    test_double();
+    test_single();
+    return failed;
+}
@@ -0,0 +1,35 @@
+#!/usr/bin/env python3
+"""
+Write a synthetic DBC with n messages for hashbench, to be compiled by
+tools/dbc2c.py like dbc/dash.dbc.
+
+    gen_dbc.py n out.dbc
+
+IDs are distinct and deterministic for a given n: half 11-bit, half
+29-bit (bit 31 set, as DBC marks them). Each message has one signal.
+"""
+
+import random
+import sys
+
+
+def main():
+    if len(sys.argv) != 3:
+        raise SystemExit('usage: gen_dbc.py n out.dbc')
+    n = int(sys.argv[1])
+    rng = random.Random(n)
+
+    sff = rng.sample(range(1, 0x800), n // 2)
+    eff = [0x80000000 | i for i in rng.sample(range(0x800, 0x20000000), n - n // 2)]
+    ids = sff + eff
+    rng.shuffle(ids)
+
+    with open(sys.argv[2], 'w') as f:
+        f.write('VERSION ""\n\nNS_ :\n\nBS_:\n\nBU_: ECU DASH\n\n')
+        for i, dbc_id in enumerate(ids):
+            f.write('BO_ %d Msg%d: 8 ECU\n' % (dbc_id, i))
+            f.write(' SG_ Value : 0|16@1+ (1,0) [0|65535] "" DASH\n\n')
+
+
+if __name__ == '__main__':
+    main()
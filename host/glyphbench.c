@@ -0,0 +1,82 @@
+// Text rendering throughput on an 800x480 surface: a full page of 8x12
+// glyphs drawn the old way (fill the background, then fb_draw_text()
+// plots each set bit) and with the span path, fb_draw_text_bg(). The
+// two pages are checked pixel for pixel against each other.
+//
+//   glyphbench [pages]
+
+#include "framebuffer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+uint64_t host_now_ns(void);
+void timer_init(void);
+
+#define W       800
+#define H       480
+#define COLS    (W / 8)
+#define ROWS    (H / 12)
+
+#define FG      0xFFE0E0E0
+#define BG      0xFF202020
+
+static uint32_t plot_mem[W * H], span_mem[W * H];
+static char text[ROWS][COLS + 1];
+
+// Printable ASCII, shifted per line and page so no two pages match
+static void fill_text(uint32_t page) {
+    for (uint32_t r = 0; r < ROWS; r++) {
+        for (uint32_t c = 0; c < COLS; c++)
+            text[r][c] = (char)(32 + (r * 7 + c + page) % 95);
+        text[r][COLS] = 0;
+    }
+}
+
+static void draw_plot(framebuffer_t *fb) {
+    for (uint32_t r = 0; r < ROWS; r++) {
+        fb_fill_rect(fb, 0, r * 12, W, 12, BG);
+        fb_draw_text(fb, 0, r * 12, text[r], FG);
+    }
+}
+
+static void draw_span(framebuffer_t *fb) {
+    for (uint32_t r = 0; r < ROWS; r++)
+        fb_draw_text_bg(fb, 0, (int32_t)(r * 12), text[r], FG, BG);
+}
+
+static double run(framebuffer_t *fb, void (*draw)(framebuffer_t *), uint32_t pages) {
+    uint64_t t = host_now_ns();
+
+    for (uint32_t p = 0; p < pages; p++) {
+        fill_text(p);
+        draw(fb);
+    }
+    double s = (host_now_ns() - t) / 1e9;
+    return (double)pages * ROWS * COLS / s;
+}
+
+int main(int argc, char **argv) {
+    uint32_t pages = argc > 1 ? (uint32_t)atoi(argv[1]) : 200;
+    framebuffer_t plot, span;
+
+    timer_init();
+    fb_init_surface(&plot, plot_mem, W, H);
+    fb_init_surface(&span, span_mem, W, H);
+
+    double plot_rate = run(&plot, draw_plot, pages);
+    double span_rate = run(&span, draw_span, pages);
+
+    printf("%u pages of %u glyphs\n", pages, ROWS * COLS);
+    printf("  fill + fb_draw_text     %8.2f Mglyphs/s  %6.1f ns/glyph\n",
+           plot_rate / 1e6, 1e9 / plot_rate);
+    printf("  fb_draw_text_bg         %8.2f Mglyphs/s  %6.1f ns/glyph  %.1fx\n",
+           span_rate / 1e6, 1e9 / span_rate, span_rate / plot_rate);
+
+    // Both drew the same last page
+    if (memcmp(plot_mem, span_mem, sizeof(plot_mem))) {
+        printf("FAIL: fb_draw_text_bg differs from fill + fb_draw_text\n");
+        return 1;
+    }
+    return 0;
+}
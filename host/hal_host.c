@@ -0,0 +1,56 @@
+// Host stand-ins for the board support the CAN stack and renderer call:
+// system timer from CLOCK_MONOTONIC, UART on stdio, no-op caches/MMU.
+// The mailbox is in sim_mbox.c.
+#include "timer.h"
+#include "uart.h"
+#include "mmu.h"
+#include "irq.h"
+#include <stdio.h>
+#include <time.h>
+
+static uint64_t start_ns;
+
+uint64_t host_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec - start_ns;
+}
+
+void timer_init(void) {
+    start_ns = 0;
+    start_ns = host_now_ns();
+}
+
+// µs since timer_init, like the free-running 1 MHz system timer
+uint64_t timer_get_counter(void) {
+    return host_now_ns() / 1000;
+}
+
+void timer_delay_us(uint32_t us) {
+    struct timespec ts = { us / 1000000, (us % 1000000) * 1000 };
+    nanosleep(&ts, 0);
+}
+
+void uart_init(void) { }
+
+void uart_putc(char c) {
+    putchar(c);
+}
+
+void uart_puts(const char *s) {
+    fputs(s, stdout);
+}
+
+bool uart_getc(char *c) {
+    return false;
+}
+
+void mmu_map_region(uintptr_t base, size_t size, mmu_mem_t type) { }
+void dcache_clean_range(const volatile void *addr, size_t size) { }
+void dcache_invalidate_range(const volatile void *addr, size_t size) { }
+void dcache_clean_invalidate_range(const volatile void *addr, size_t size) { }
+
+// No interrupt controller: the bench polls the INT latch instead
+void irq_register(uint32_t irq, irq_fn fn, void *ctx) { }
+void irq_enable(uint32_t irq) { }
+void irq_disable(uint32_t irq) { }
@@ -0,0 +1,73 @@
+// CAN ID lookup: the DB's perfect hash against a linear scan of the
+// message table, over a mix of DB IDs and IDs the DB does not know.
+// Built against dbc/dash.dbc, and as hashbench-128 and hashbench-512
+// against synthetic DBs of that many IDs (gen_dbc.py, see the Makefile).
+//
+//   hashbench [iterations]
+
+#include "can_db.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+uint64_t host_now_ns(void);
+void timer_init(void);
+
+#define NUM_KEYS 4096
+
+static const can_msg_def_t *linear_find(uint32_t id) {
+    for (uint32_t i = 0; i < CAN_DB_NUM_MESSAGES; i++) {
+        if (can_db_messages[i].id == id)
+            return &can_db_messages[i];
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    uint32_t iters = argc > 1 ? (uint32_t)atoi(argv[1]) : 10000;
+    static uint32_t keys[NUM_KEYS];
+    uint32_t seed = 1;
+
+    // Half known IDs, half random 11- and 29-bit IDs
+    for (int i = 0; i < NUM_KEYS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        if (i & 1)
+            keys[i] = can_db_messages[(seed >> 8) % CAN_DB_NUM_MESSAGES].id;
+        else if (seed & 0x100)
+            keys[i] = (seed >> 3) & CAN_SFF_MASK;
+        else
+            keys[i] = (seed & CAN_EFF_MASK) | CAN_EFF_FLAG;
+    }
+
+    // Every DB ID must come back as its own entry
+    for (uint32_t i = 0; i < CAN_DB_NUM_MESSAGES; i++) {
+        if (can_db_find(can_db_messages[i].id) != &can_db_messages[i]) {
+            printf("FAIL: can_db_find(0x%08x) misses message %u\n",
+                   can_db_messages[i].id, i);
+            return 1;
+        }
+    }
+
+    timer_init();
+
+    for (int pass = 0; pass < 2; pass++) {
+        const can_msg_def_t *(*find)(uint32_t) = pass ? linear_find : can_db_find;
+        // The scan slows with the DB: fewer rounds keep the run short
+        uint32_t rounds = pass ? iters / (1 + CAN_DB_NUM_MESSAGES / 16) : iters;
+        uintptr_t sink = 0;
+        uint64_t t = host_now_ns();
+
+        if (!rounds)
+            rounds = 1;
+        for (uint32_t it = 0; it < rounds; it++) {
+            for (int i = 0; i < NUM_KEYS; i++)
+                sink += (uintptr_t)find(keys[i]);
+        }
+
+        double s = (host_now_ns() - t) / 1e9;
+        printf("%-12s %8.1f M lookups/s (%u messages)%s\n",
+               pass ? "linear scan" : "perfect hash",
+               (double)rounds * NUM_KEYS / s / 1e6, CAN_DB_NUM_MESSAGES,
+               sink == 1 ? " " : "");
+    }
+    return 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * The AdvSIMD intrinsics fb_simd uses, in portable C on GCC vector
+ * types, so the FB_SIMD paths (their alignment heads and scalar tails
+ * included) build and run on a host without NEON. Lane semantics match
+ * the ARM definitions; speed does not.
+ */
+
+typedef uint32_t uint32x4_t __attribute__((vector_size(16)));
+
+typedef struct {
+    uint32x4_t val[4];
+} uint32x4x4_t;
+
+static inline uint32x4_t vdupq_n_u32(uint32_t v) {
+    return (uint32x4_t){ v, v, v, v };
+}
+
+static inline uint32x4_t vld1q_u32(const uint32_t *p) {
+    uint32x4_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void vst1q_u32(uint32_t *p, uint32x4_t v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline uint32x4x4_t vld1q_u32_x4(const uint32_t *p) {
+    uint32x4x4_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void vst1q_u32_x4(uint32_t *p, uint32x4x4_t v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+// Bitwise select: bits of a where m is set, of b where it is clear
+static inline uint32x4_t vbslq_u32(uint32x4_t m, uint32x4_t a, uint32x4_t b) {
+    return (a & m) | (b & ~m);
+}
+
+static inline uint32x4_t vceqq_u32(uint32x4_t a, uint32x4_t b) {
+    return (uint32x4_t)(a == b);
+}
@@ -0,0 +1,227 @@
+// Stress test for the SPSC frame ring (can_ring.h) on two threads
+// standing in for the INT service and the CAN core: every frame the
+// consumer sees must be whole and in order, and the drop and high-water
+// counters must match what the producer saw.
+//
+//   ringbench [frames]
+
+#include "can_ring.h"
+#include "sync.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+uint64_t host_now_ns(void);
+void timer_init(void);
+
+static can_ring_t ring;
+static uint32_t frames;
+static int failed;
+
+#define CHECK(cond) do {                                            \
+        if (!(cond)) {                                              \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);  \
+            failed = 1;                                             \
+        }                                                           \
+    } while (0)
+
+// Everything in the frame derives from its sequence number, so a slot
+// read before the producer finished writing it shows up as a mismatch
+static void make_frame(can_frame_t *f, uint32_t seq) {
+    memset(f, 0, sizeof(*f));
+    f->id = seq & 0x7FF;
+    f->dlc = 8;
+    for (int i = 0; i < 4; i++) {
+        f->data[i] = (uint8_t)(seq >> (8 * i));
+        f->data[4 + i] = (uint8_t)~(seq >> (8 * i));
+    }
+}
+
+static bool frame_ok(const can_rx_t *rx, uint32_t *seq) {
+    can_frame_t want;
+
+    *seq = (uint32_t)rx->ts;
+    make_frame(&want, *seq);
+    return memcmp(&want, &rx->frame, sizeof(want)) == 0;
+}
+
+// ------------------------------------------------------------
+// Threads
+// ------------------------------------------------------------
+
+static bool lossy;              // producer drops when full, like the ISR
+static uint32_t refused;        // pushes that returned false
+static volatile int producer_done;
+
+static void *producer(void *arg) {
+    can_frame_t f;
+
+    for (uint32_t seq = 0; seq < frames; seq++) {
+        make_frame(&f, seq);
+        while (!can_ring_push(&ring, &f, seq)) {
+            refused++;
+            if (lossy)
+                break;
+            sched_yield();      // let the consumer in on a single CPU
+        }
+        // Frames arrive in bursts; between them the consumer gets a turn
+        if (lossy && seq % 1024 == 1023)
+            sched_yield();
+    }
+    sync_store_rel(&producer_done, 1);
+    return 0;
+}
+
+static struct {
+    uint32_t received;
+    uint32_t bad;               // torn frames
+    uint32_t out_of_order;      // repeated or going backwards
+    uint32_t gaps;              // frames skipped (lossy mode only)
+} cons;
+
+static void consume_one(const can_rx_t *rx, uint32_t *next) {
+    uint32_t seq;
+
+    if (!frame_ok(rx, &seq))
+        cons.bad++;
+    if (seq < *next)
+        cons.out_of_order++;
+    else if (seq > *next)
+        cons.gaps += seq - *next;
+    *next = seq + 1;
+    cons.received++;
+}
+
+// Alternates batch peeks with single pops, and now and then stalls so
+// the ring fills up
+static void *consumer(void *arg) {
+    uint32_t next = 0;
+    uint32_t pass = 0;
+
+    for (;;) {
+        const can_rx_t *batch;
+        can_rx_t one;
+        uint32_t n;
+
+        if (++pass % 64 == 0) {
+            for (volatile int spin = 0; spin < 20000; spin++) { }
+        }
+
+        if (pass & 1) {
+            n = can_ring_peek(&ring, &batch);
+            for (uint32_t i = 0; i < n; i++)
+                consume_one(&batch[i], &next);
+            can_ring_consume(&ring, n);
+        } else {
+            n = can_ring_pop(&ring, &one);
+            if (n)
+                consume_one(&one, &next);
+        }
+
+        if (!n) {
+            if (sync_load_acq(&producer_done) && !can_ring_count(&ring))
+                break;
+            sched_yield();
+        }
+    }
+    // Frames dropped after the last one received
+    cons.gaps += frames - next;
+    return 0;
+}
+
+static void run(bool drop) {
+    pthread_t p, c;
+
+    can_ring_init(&ring);
+    memset(&cons, 0, sizeof(cons));
+    lossy = drop;
+    refused = 0;
+    producer_done = 0;
+
+    uint64_t t = host_now_ns();
+    pthread_create(&c, 0, consumer, 0);
+    pthread_create(&p, 0, producer, 0);
+    pthread_join(p, 0);
+    pthread_join(c, 0);
+    double s = (host_now_ns() - t) / 1e9;
+
+    int was_failed = failed;
+    failed = 0;
+
+    CHECK(cons.bad == 0);
+    CHECK(cons.out_of_order == 0);
+    CHECK(can_ring_dropped(&ring) == refused);
+    CHECK(can_ring_high_water(&ring) <= CAN_RING_SIZE);
+    CHECK(can_ring_count(&ring) == 0);
+    if (drop) {
+        CHECK(cons.received + refused == frames);
+        CHECK(cons.gaps == refused);
+    } else {
+        CHECK(cons.received == frames);
+        CHECK(cons.gaps == 0);
+    }
+    // Refused pushes only ever happen with the ring full
+    if (refused)
+        CHECK(can_ring_high_water(&ring) == CAN_RING_SIZE);
+
+    // A lossless producer retries a refused push, so nothing is lost
+    printf("%-9s %s  %u frames  %u received  %u %s  high water %u  %.2f Mframes/s\n",
+           drop ? "lossy" : "lossless", failed ? "FAIL" : "ok  ", frames,
+           cons.received, refused, drop ? "dropped" : "retries",
+           can_ring_high_water(&ring), cons.received / s / 1e6);
+    failed |= was_failed;
+}
+
+// ------------------------------------------------------------
+// Single thread: the edges, exactly
+// ------------------------------------------------------------
+
+static void edges(void) {
+    can_frame_t f;
+    const can_rx_t *batch;
+    uint32_t seq;
+
+    can_ring_init(&ring);
+
+    // Fill, then one more
+    for (uint32_t i = 0; i < CAN_RING_SIZE; i++) {
+        make_frame(&f, i);
+        CHECK(can_ring_push(&ring, &f, i));
+    }
+    make_frame(&f, CAN_RING_SIZE);
+    CHECK(!can_ring_push(&ring, &f, CAN_RING_SIZE));
+    CHECK(can_ring_dropped(&ring) == 1);
+    CHECK(can_ring_high_water(&ring) == CAN_RING_SIZE);
+    CHECK(can_ring_count(&ring) == CAN_RING_SIZE);
+
+    // Free a few and refill across the wrap: the peek stops at the wrap
+    CHECK(can_ring_peek(&ring, &batch) == CAN_RING_SIZE);
+    can_ring_consume(&ring, 10);
+    for (uint32_t i = 0; i < 10; i++) {
+        make_frame(&f, CAN_RING_SIZE + i);
+        CHECK(can_ring_push(&ring, &f, CAN_RING_SIZE + i));
+    }
+    CHECK(can_ring_peek(&ring, &batch) == CAN_RING_SIZE - 10);
+    CHECK(frame_ok(&batch[0], &seq) && seq == 10);
+    can_ring_consume(&ring, CAN_RING_SIZE - 10);
+
+    CHECK(can_ring_peek(&ring, &batch) == 10);
+    CHECK(frame_ok(&batch[9], &seq) && seq == CAN_RING_SIZE + 9);
+    can_ring_consume(&ring, 10);
+    CHECK(can_ring_count(&ring) == 0);
+    CHECK(can_ring_high_water(&ring) == CAN_RING_SIZE);
+
+    printf("%-9s %s\n", "edges", failed ? "FAIL" : "ok  ");
+}
+
+int main(int argc, char **argv) {
+    frames = argc > 1 ? (uint32_t)atoi(argv[1]) : 2000000;
+    timer_init();
+
+    edges();
+    run(false);
+    run(true);
+    return failed;
+}
@@ -0,0 +1,332 @@
+#include "sim_dma.h"
+#include "dma.h"
+#include "peripherals.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define DMA_REG(addr)       ((addr) - DMA_BASE)
+#define DMA_CH_REGS         0x100
+#define DMA_INT_STATUS      0xFE0
+#define DMA_ENABLE          0xFF0
+
+#define CS_ACTIVE           (1u << 0)
+#define CS_END              (1u << 1)
+#define CS_INT              (1u << 2)
+#define CS_ERROR            (1u << 8)
+#define CS_ABORT            (1u << 30)
+#define CS_RESET            (1u << 31)
+
+#define DEBUG_READ_ERROR    (1u << 2)
+
+// Bus aliases, as in src/dma.c
+#define BUS_PERIPH_BASE     0x7E000000u
+#define BUS_SDRAM_UNCACHED  0xC0000000u
+
+// ------------------------------------------------------------
+// Bus addresses: each region a host pointer falls in gets a 64 KB
+// window of the uncached SDRAM alias
+// ------------------------------------------------------------
+
+#define REGION_SIZE     0x10000u
+#define MAX_REGIONS     256
+
+static const volatile uint8_t *regions[MAX_REGIONS];
+static uint32_t num_regions;
+
+uint32_t sim_dma_bus_addr(const volatile void *p) {
+    const volatile uint8_t *b = p;
+    uint32_t i;
+
+    for (i = 0; i < num_regions; i++) {
+        if (b >= regions[i] && (size_t)(b - regions[i]) < REGION_SIZE)
+            break;
+    }
+    if (i == num_regions) {
+        if (num_regions == MAX_REGIONS)
+            return 0;
+        regions[num_regions++] = b;
+    }
+
+    return BUS_SDRAM_UNCACHED | (i + 1) << 16 | (uint32_t)(b - regions[i]);
+}
+
+static volatile uint8_t *bus_ptr(uint32_t bus) {
+    uint32_t i = ((bus & ~BUS_SDRAM_UNCACHED) >> 16) - 1;
+
+    if ((bus & 0xF0000000u) != BUS_SDRAM_UNCACHED || i >= num_regions)
+        return 0;
+    return (volatile uint8_t *)regions[i] + (bus & (REGION_SIZE - 1));
+}
+
+static bool is_periph(uint32_t bus) {
+    return (bus & 0xFF000000u) == BUS_PERIPH_BASE;
+}
+
+// ------------------------------------------------------------
+// Channels
+// ------------------------------------------------------------
+
+typedef struct {
+    uint32_t cs;
+    uint32_t conblk_ad;         // block being run, 0 at the chain's end
+    uint32_t debug;
+
+    // Working copy of the loaded block
+    uint32_t ti, src, dst, left, next;
+
+    sim_dma_stats_t stats;
+} chan_t;
+
+static chan_t chans[DMA_NUM_CH];
+static uint32_t int_status;
+static uint32_t enable;
+static sim_dma_periph_t periphs[32];
+
+void sim_dma_attach(uint32_t dreq, const sim_dma_periph_t *p) {
+    periphs[dreq & 31] = *p;
+}
+
+static void stop_error(chan_t *c, uint32_t debug) {
+    c->cs = (c->cs & ~CS_ACTIVE) | CS_ERROR;
+    c->debug |= debug;
+    c->stats.errors++;
+}
+
+// Load the block at conblk_ad, like the engine does on ACTIVE and after
+// each block
+static void load(chan_t *c) {
+    volatile uint8_t *p = bus_ptr(c->conblk_ad);
+
+    if (!p || ((uintptr_t)p & 31)) {
+        stop_error(c, DEBUG_READ_ERROR);
+        return;
+    }
+
+    const volatile dma_cb_t *cb = (const volatile dma_cb_t *)p;
+    c->ti = cb->ti;
+    c->src = cb->source_ad;
+    c->dst = cb->dest_ad;
+    c->left = cb->txfr_len;
+    c->next = cb->nextconbk;
+}
+
+static void end_block(chan_t *c, uint32_t ch) {
+    c->stats.blocks++;
+    c->cs |= CS_END;
+    if (c->ti & DMA_TI_INTEN) {
+        c->cs |= CS_INT;
+        int_status |= 1u << ch;
+    }
+
+    c->conblk_ad = c->next;
+    if (c->conblk_ad)
+        load(c);
+    else
+        c->cs &= ~CS_ACTIVE;
+}
+
+// One word: 1 moved, 0 stalled on the source peripheral, -1 stopped
+static int move_word(chan_t *c) {
+    uint32_t n = c->left < 4 ? c->left : 4;
+    uint32_t dreq = (c->ti >> 16) & 31;
+    uint32_t w = 0;
+
+    if (is_periph(c->src)) {
+        if (!(c->ti & DMA_TI_SRC_DREQ))
+            c->stats.unpaced++;
+        if (!periphs[dreq].read) {
+            stop_error(c, DEBUG_READ_ERROR);
+            return -1;
+        }
+        if (!periphs[dreq].read(&w, periphs[dreq].ctx))
+            return 0;
+    } else {
+        volatile uint8_t *p = bus_ptr(c->src);
+        if (!p) {
+            stop_error(c, DEBUG_READ_ERROR);
+            return -1;
+        }
+        memcpy(&w, (const void *)p, n);
+    }
+
+    if (is_periph(c->dst)) {
+        if (!(c->ti & DMA_TI_DEST_DREQ))
+            c->stats.unpaced++;
+        if (!periphs[dreq].write) {
+            stop_error(c, DEBUG_READ_ERROR);
+            return -1;
+        }
+        periphs[dreq].write(w, periphs[dreq].ctx);
+    } else {
+        volatile uint8_t *p = bus_ptr(c->dst);
+        if (!p) {
+            stop_error(c, DEBUG_READ_ERROR);
+            return -1;
+        }
+        memcpy((void *)p, &w, n);
+    }
+
+    if (c->ti & DMA_TI_SRC_INC)
+        c->src += 4;
+    if (c->ti & DMA_TI_DEST_INC)
+        c->dst += 4;
+    c->left -= n;
+    c->stats.words++;
+    return 1;
+}
+
+// Advance ch by a word, or past an empty block; false if it cannot move
+static bool advance(uint32_t ch) {
+    chan_t *c = &chans[ch];
+
+    if (!(c->cs & CS_ACTIVE))
+        return false;
+    if (c->left && move_word(c) <= 0)
+        return false;
+    if (!c->left)
+        end_block(c, ch);
+    return true;
+}
+
+uint32_t sim_dma_run(void) {
+    uint32_t moved = 0;
+    bool progress = true;
+
+    while (progress) {
+        progress = false;
+        for (uint32_t ch = 0; ch < DMA_NUM_CH; ch++) {
+            if (advance(ch)) {
+                progress = true;
+                moved++;
+            }
+        }
+    }
+    return moved;
+}
+
+bool sim_dma_step(uint32_t ch) {
+    uint32_t blocks = chans[ch].stats.blocks;
+
+    while (chans[ch].stats.blocks == blocks) {
+        if (!advance(ch))
+            return false;
+    }
+    return true;
+}
+
+void sim_dma_stats(uint32_t ch, sim_dma_stats_t *out) {
+    *out = chans[ch].stats;
+}
+
+static void cs_write(uint32_t ch, uint32_t v) {
+    chan_t *c = &chans[ch];
+
+    if (v & CS_RESET) {
+        sim_dma_stats_t keep = c->stats;
+        memset(c, 0, sizeof(*c));
+        c->stats = keep;
+        int_status &= ~(1u << ch);
+        return;
+    }
+
+    if (v & CS_END)
+        c->cs &= ~CS_END;
+    if (v & CS_INT) {
+        c->cs &= ~CS_INT;
+        int_status &= ~(1u << ch);
+    }
+
+    if (v & CS_ABORT) {
+        c->conblk_ad = c->next;
+        c->left = 0;
+    }
+
+    if (!(v & CS_ACTIVE)) {
+        c->cs &= ~CS_ACTIVE;
+    } else if (!(c->cs & CS_ACTIVE) && c->conblk_ad) {
+        c->cs |= CS_ACTIVE;
+        if (!c->left)
+            load(c);
+    }
+}
+
+// ------------------------------------------------------------
+// Register interface
+// ------------------------------------------------------------
+
+// Registers of other devices: last value written
+static struct {
+    uintptr_t addr;
+    uint32_t val;
+} other[64];
+static uint32_t num_other;
+
+static uint32_t *other_reg(uintptr_t addr) {
+    for (uint32_t i = 0; i < num_other; i++) {
+        if (other[i].addr == addr)
+            return &other[i].val;
+    }
+    if (num_other == 64)
+        return 0;
+    other[num_other].addr = addr;
+    other[num_other].val = 0;
+    return &other[num_other++].val;
+}
+
+static bool is_dma(uintptr_t addr) {
+    return addr >= DMA_BASE && addr < DMA_BASE + 0x1000;
+}
+
+void sim_mmio_write(uintptr_t addr, uint32_t val) {
+    if (!is_dma(addr)) {
+        uint32_t *r = other_reg(addr);
+        if (r)
+            *r = val;
+        return;
+    }
+
+    uint32_t off = DMA_REG(addr);
+    if (off == DMA_ENABLE) {
+        enable = val;
+        return;
+    }
+    if (off >= DMA_NUM_CH * DMA_CH_REGS)
+        return;
+
+    chan_t *c = &chans[off / DMA_CH_REGS];
+    switch (off % DMA_CH_REGS) {
+    case 0x00: cs_write(off / DMA_CH_REGS, val); break;
+    case 0x04: c->conblk_ad = val; c->left = 0; break;
+    case 0x20: c->debug &= ~val; c->cs &= ~CS_ERROR; break;
+    }
+}
+
+uint32_t sim_mmio_read(uintptr_t addr) {
+    if (!is_dma(addr)) {
+        uint32_t *r = other_reg(addr);
+        return r ? *r : 0;
+    }
+
+    uint32_t off = DMA_REG(addr);
+    if (off == DMA_INT_STATUS)
+        return int_status;
+    if (off == DMA_ENABLE)
+        return enable;
+    if (off >= DMA_NUM_CH * DMA_CH_REGS)
+        return 0;
+
+    chan_t *c = &chans[off / DMA_CH_REGS];
+    switch (off % DMA_CH_REGS) {
+    case 0x00: return c->cs;
+    case 0x04: return c->conblk_ad;
+    case 0x08: return c->ti;
+    case 0x0C: return c->src;
+    case 0x10: return c->dst;
+    case 0x14: return c->left;
+    case 0x1C: return c->next;
+    case 0x20: return c->debug;
+    }
+    return 0;
+}
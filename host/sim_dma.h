@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Fake BCM2837 DMA engine for host builds, behind the registers
+ * src/dma.c programs (mmio_* go to sim_mmio_read/write under HOST_SIM).
+ *
+ * A channel set ACTIVE loads the control block at CONBLK_AD and walks
+ * the chain through nextconbk, honouring TI: SRC_INC / DEST_INC,
+ * SRC_DREQ / DEST_DREQ with PERMAP picking a simulated peripheral, and
+ * INTEN raising CS.INT and the channel's INT_STATUS bit when its block
+ * ends. CS.END is set as each block ends and ACTIVE drops after the
+ * last. Words are 32 bits. A control block that is not 32-byte aligned,
+ * or an address the engine cannot map, stops the channel with CS.ERROR.
+ *
+ * Nothing moves until sim_dma_run() or sim_dma_step(), so callers can
+ * look at a transfer in flight. Other peripheral registers read back
+ * what was last written to them.
+ */
+
+typedef struct {
+    // Word from the peripheral; false while it has none (the DREQ is low)
+    bool (*read)(uint32_t *w, void *ctx);
+    // Word to the peripheral; sinks always take it
+    void (*write)(uint32_t w, void *ctx);
+    void *ctx;
+} sim_dma_periph_t;
+
+typedef struct {
+    uint32_t blocks;        // control blocks finished
+    uint32_t words;         // words moved
+    uint32_t errors;        // chains stopped with CS.ERROR
+    uint32_t unpaced;       // peripheral accesses without the TI DREQ flag
+} sim_dma_stats_t;
+
+/* Peripheral behind DREQ line dreq (TI PERMAP) */
+void sim_dma_attach(uint32_t dreq, const sim_dma_periph_t *p);
+
+/* Move words on every active channel, round robin, until none can;
+ * returns the number moved */
+uint32_t sim_dma_run(void);
+/* Run channel ch to the end of its current control block; false if it
+ * is idle or stalls on its peripheral first */
+bool sim_dma_step(uint32_t ch);
+
+void sim_dma_stats(uint32_t ch, sim_dma_stats_t *out);
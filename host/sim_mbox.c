@@ -0,0 +1,147 @@
+#include "sim_mbox.h"
+#include "mailbox.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+
+#define MBOX_RESPONSE   0x80000000u
+#define TAG_RESPONSE    0x80000000u
+
+// Low enough that its bus alias, & 0x3FFFFFFF, is the address itself
+#define BUF_ADDR        0x30000000u
+#define BUS_ALIAS       0xC0000000u
+
+static sim_mbox_state_t st;
+static uint32_t max_virt_height;
+static bool failing;
+static uint32_t depth = 32;
+static uint32_t virt_width;
+
+static uint8_t *buf;
+static uint32_t buf_size;
+
+void sim_mbox_max_virtual_height(uint32_t h) {
+    max_virt_height = h;
+}
+
+void sim_mbox_fail(bool fail) {
+    failing = fail;
+}
+
+void sim_mbox_state(sim_mbox_state_t *out) {
+    *out = st;
+}
+
+uint8_t *sim_mbox_buffer(void) {
+    return buf;
+}
+
+static uint32_t pitch(void) {
+    return virt_width * (depth / 8);
+}
+
+// Map a fresh buffer for the current virtual screen, as the firmware
+// does on every allocate
+static bool allocate(void) {
+    uint32_t size = pitch() * st.virt_height;
+
+    if (buf)
+        munmap(buf, buf_size);
+    buf = 0;
+    buf_size = 0;
+    if (!size)
+        return false;
+
+    void *p = mmap((void *)(uintptr_t)BUF_ADDR, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (p == MAP_FAILED)
+        return false;
+
+    buf = p;
+    buf_size = size;
+    return true;
+}
+
+// Answer one tag; v is its value buffer. False leaves it unanswered.
+static bool answer(uint32_t tag, volatile uint32_t *v, uint32_t *len) {
+    switch (tag) {
+    case 0x00048003:        // set physical width/height
+        st.width = v[0];
+        st.height = v[1];
+        *len = 8;
+        return true;
+
+    case 0x00048004:        // set virtual width/height
+        virt_width = v[0];
+        st.virt_height = v[1];
+        if (max_virt_height && st.virt_height > max_virt_height)
+            st.virt_height = max_virt_height;
+        v[1] = st.virt_height;
+        *len = 8;
+        return true;
+
+    case 0x00048005:        // set depth
+        depth = v[0];
+        *len = 4;
+        return true;
+
+    case 0x00048006:        // set pixel order
+        *len = 4;
+        return true;
+
+    case 0x00040001:        // allocate buffer: alignment in, base and size out
+        if (allocate()) {
+            v[0] = BUS_ALIAS | BUF_ADDR;
+            v[1] = buf_size;
+        } else {
+            v[0] = 0;
+            v[1] = 0;
+        }
+        *len = 8;
+        return true;
+
+    case 0x00040008:        // get pitch
+        v[0] = pitch();
+        *len = 4;
+        return true;
+
+    case 0x00048009: {      // set virtual offset
+        uint32_t max_y = st.virt_height > st.height ? st.virt_height - st.height : 0;
+        st.y_offset = v[1] < max_y ? v[1] : max_y;
+        v[1] = st.y_offset;
+        *len = 8;
+        return true;
+    }
+
+    case 0x0004800E:        // wait for vsync
+        st.vsyncs++;
+        st.vsync_offset = st.y_offset;
+        *len = 4;
+        return true;
+    }
+    return false;
+}
+
+bool mbox_call(uint8_t ch, volatile uint32_t *mbox) {
+    if (failing || ch != 8)
+        return false;
+
+    // Walk the tags: id, value buffer size, request/response length, values
+    uint32_t words = mbox[0] / 4;
+    uint32_t i = 2;
+
+    while (i + 3 <= words && mbox[i]) {
+        uint32_t size = mbox[i + 1];
+        uint32_t len;
+
+        if (answer(mbox[i], &mbox[i + 3], &len))
+            mbox[i + 2] = TAG_RESPONSE | len;
+        else
+            st.unknown++;
+        i += 3 + size / 4;
+    }
+
+    mbox[1] = MBOX_RESPONSE;
+    st.calls++;
+    return true;
+}
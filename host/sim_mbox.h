@@ -0,0 +1,41 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Fake VideoCore property channel for host builds: mbox_call() walks the
+ * tag list and answers the framebuffer tags fb_init() and fb_swap() send.
+ *
+ *   0x48003/0x48005/0x48006   physical size, depth, pixel order: echoed
+ *   0x48004                   virtual size: height capped by
+ *                             sim_mbox_max_virtual_height()
+ *   0x40001/0x40008           allocate buffer, get pitch
+ *   0x48009                   virtual offset: y clamped to the screen
+ *   0x4800E                   wait for vsync: counted
+ *
+ * The buffer is mapped below 1 GB so the bus address the firmware would
+ * report survives fb_init()'s & 0x3FFFFFFF. Other tags are left
+ * unanswered, as the firmware leaves tags it does not know.
+ */
+
+typedef struct {
+    uint32_t calls;         // property calls answered
+    uint32_t width;         // physical size
+    uint32_t height;
+    uint32_t virt_height;   // virtual height granted
+    uint32_t y_offset;      // virtual offset on screen
+    uint32_t vsyncs;        // vsync waits
+    uint32_t vsync_offset;  // y_offset when the last vsync wait came
+    uint32_t unknown;       // tags left unanswered
+} sim_mbox_state_t;
+
+/* Grant at most h lines of virtual screen; 0 grants whatever is asked */
+void sim_mbox_max_virtual_height(uint32_t h);
+
+/* Make mbox_call() fail, as on a timeout or a bad request */
+void sim_mbox_fail(bool fail);
+
+void sim_mbox_state(sim_mbox_state_t *out);
+
+/* Pixels of the allocated buffer, for checking what was drawn */
+uint8_t *sim_mbox_buffer(void);
@@ -0,0 +1,560 @@
+#include "sim_mcp2515.h"
+#include "mcp2515_regs.h"
+#include "spi.h"
+#include "dma.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Registers beyond mcp2515_regs.h
+#define MODE_SLEEP      0x20
+#define MODE_LOOPBACK   0x40
+#define MODE_LISTEN     0x60
+#define CMD_RX_STATUS   0xB0
+
+#define SIM_XTAL_HZ     16000000
+
+static uint8_t regs[128];
+static sim_mcp_stats_t stats;
+
+static uint32_t bus_bps;        // 0: any bit timing receives
+static bool int_low;            // INT pin asserted
+static bool int_edge;           // falling edge latched, cleared by software
+static bool tx_hold;            // RTS leaves TXREQ set until released
+
+// Transmitted frames, oldest first, for sim_mcp_tx_frame()
+#define TX_LOG_SIZE     64
+static can_frame_t tx_log[TX_LOG_SIZE];
+static uint32_t tx_log_head, tx_log_tail;
+
+// ------------------------------------------------------------
+// Register file
+// ------------------------------------------------------------
+
+static void reset(void) {
+    memset(regs, 0, sizeof(regs));
+    regs[MCP_CANCTRL] = 0x87;   // config mode, one-shot off, CLKOUT on
+    regs[MCP_CANSTAT] = 0x80;
+}
+
+static void update_int(void) {
+    bool low = (regs[MCP_CANINTF] & regs[MCP_CANINTE]) != 0;
+    if (low && !int_low)
+        int_edge = true;
+    int_low = low;
+}
+
+static uint8_t mode(void) {
+    return regs[MCP_CANSTAT] & MCP_MODE_MASK;
+}
+
+// Frame or filter registers as (is_ext, 11-bit SID, 18-bit EID)
+static void split_id(const uint8_t *r, uint32_t *sid, uint32_t *eid) {
+    *sid = ((uint32_t)r[0] << 3) | (r[1] >> 5);
+    *eid = ((uint32_t)(r[1] & 0x03) << 16) | ((uint32_t)r[2] << 8) | r[3];
+}
+
+static void log_tx(int n) {
+    const uint8_t *r = &regs[MCP_TXBCTRL(n) + 1];
+    uint32_t sid, eid;
+
+    if (tx_log_head - tx_log_tail == TX_LOG_SIZE)
+        return;
+
+    can_frame_t *f = &tx_log[tx_log_head++ % TX_LOG_SIZE];
+    split_id(r, &sid, &eid);
+    if (r[1] & MCP_SIDL_IDE)
+        f->id = CAN_EFF_FLAG | (sid << 18) | eid;
+    else
+        f->id = sid;
+    f->dlc = r[4] & 0x0F;
+    memcpy(f->data, &r[5], 8);
+}
+
+static void transmit(int n) {
+    uint8_t *ctrl = &regs[MCP_TXBCTRL(n)];
+
+    if (mode() != MCP_MODE_NORMAL && mode() != MODE_LOOPBACK)
+        return;
+    if (tx_hold)
+        return;
+
+    log_tx(n);
+    *ctrl &= ~(MCP_TXB_TXREQ | MCP_TXB_TXERR | MCP_TXB_MLOA);
+    regs[MCP_CANINTF] |= MCP_INT_TX(n);
+    stats.transmitted++;
+}
+
+// CANSTAT and CANCTRL are mirrored at the end of every 16-byte row
+static uint8_t reg_read(uint8_t addr) {
+    addr &= 0x7F;
+    if ((addr & 0x0F) == 0x0E)
+        return regs[MCP_CANSTAT];
+    if ((addr & 0x0F) == 0x0F)
+        return regs[MCP_CANCTRL];
+    return regs[addr];
+}
+
+static void reg_write(uint8_t addr, uint8_t val) {
+    addr &= 0x7F;
+    if ((addr & 0x0F) == 0x0F)
+        addr = MCP_CANCTRL;
+
+    switch (addr) {
+    case MCP_CANSTAT:
+        return;                                 // read-only
+
+    case MCP_CANCTRL:
+        regs[MCP_CANCTRL] = val;
+        // Mode changes take effect at once
+        regs[MCP_CANSTAT] = (regs[MCP_CANSTAT] & ~MCP_MODE_MASK) | (val & MCP_MODE_MASK);
+        return;
+
+    case MCP_EFLG:
+        // Only the overflow flags can be cleared by software
+        regs[MCP_EFLG] &= val | ~(MCP_EFLG_RX0OVR | MCP_EFLG_RX1OVR);
+        return;
+
+    case MCP_TXBCTRL(0):
+    case MCP_TXBCTRL(1):
+    case MCP_TXBCTRL(2):
+        regs[addr] = (regs[addr] & ~0x0B) | (val & 0x0B);
+        if (val & MCP_TXB_TXREQ)
+            transmit((addr - MCP_TXBCTRL(0)) >> 4);
+        return;
+    }
+
+    regs[addr] = val;
+}
+
+static uint8_t read_status(void) {
+    uint8_t intf = regs[MCP_CANINTF];
+    uint8_t s = intf & (MCP_INT_RX0 | MCP_INT_RX1);
+
+    for (int n = 0; n < 3; n++) {
+        if (regs[MCP_TXBCTRL(n)] & MCP_TXB_TXREQ)
+            s |= 0x04 << (n * 2);
+        if (intf & MCP_INT_TX(n))
+            s |= MCP_STAT_TXIF(n);
+    }
+    return s;
+}
+
+static uint8_t rx_status(void) {
+    uint8_t s = (regs[MCP_CANINTF] & (MCP_INT_RX0 | MCP_INT_RX1)) << 6;
+    uint8_t rxb = (s & 0x40) ? MCP_RXB0CTRL : MCP_RXB1CTRL;
+
+    if (regs[rxb + 2] & MCP_SIDL_IDE)
+        s |= 0x10;
+    return s;
+}
+
+// ------------------------------------------------------------
+// Acceptance filtering and RX buffers
+// ------------------------------------------------------------
+
+static bool filter_hit(uint8_t faddr, uint8_t maddr, const can_frame_t *f) {
+    bool ext = (f->id & CAN_EFF_FLAG) != 0;
+    uint32_t fsid, feid, msid, meid;
+
+    split_id(&regs[faddr], &fsid, &feid);
+    split_id(&regs[maddr], &msid, &meid);
+
+    // EXIDE selects which frame type the filter applies to
+    if (((regs[faddr + 1] & MCP_SIDL_IDE) != 0) != ext)
+        return false;
+
+    if (ext) {
+        uint32_t id = f->id & CAN_EFF_MASK;
+        uint32_t fid = (fsid << 18) | feid, mid = (msid << 18) | meid;
+        return ((id ^ fid) & mid) == 0;
+    }
+    return ((f->id ^ fsid) & msid) == 0;
+}
+
+static bool accepts(int rxb, const can_frame_t *f) {
+    static const uint8_t filt0[] = { MCP_RXF0SIDH, MCP_RXF1SIDH };
+    static const uint8_t filt1[] = { MCP_RXF2SIDH, MCP_RXF3SIDH, MCP_RXF4SIDH, MCP_RXF5SIDH };
+    uint8_t ctrl = regs[rxb ? MCP_RXB1CTRL : MCP_RXB0CTRL];
+
+    if ((ctrl & MCP_RXM_ANY) == MCP_RXM_ANY)
+        return true;
+
+    const uint8_t *filt = rxb ? filt1 : filt0;
+    int n = rxb ? 4 : 2;
+    for (int i = 0; i < n; i++) {
+        if (filter_hit(filt[i], rxb ? MCP_RXM1SIDH : MCP_RXM0SIDH, f))
+            return true;
+    }
+    return false;
+}
+
+static void load_rxb(int rxb, const can_frame_t *f) {
+    uint8_t *r = &regs[rxb ? MCP_RXB1CTRL + 1 : MCP_RXB0SIDH];
+    uint8_t dlc = f->dlc > 8 ? 8 : f->dlc;
+
+    if (f->id & CAN_EFF_FLAG) {
+        uint32_t id = f->id & CAN_EFF_MASK;
+        uint32_t sid = id >> 18, eid = id & 0x3FFFF;
+        r[0] = sid >> 3;
+        r[1] = ((sid & 7) << 5) | MCP_SIDL_IDE | (eid >> 16);
+        r[2] = (eid >> 8) & 0xFF;
+        r[3] = eid & 0xFF;
+    } else {
+        r[0] = f->id >> 3;
+        r[1] = (f->id & 7) << 5;
+        r[2] = 0;
+        r[3] = 0;
+    }
+    r[4] = dlc;
+    memcpy(&r[5], f->data, 8);
+
+    regs[MCP_CANINTF] |= rxb ? MCP_INT_RX1 : MCP_INT_RX0;
+}
+
+static void overflow(uint8_t flag) {
+    regs[MCP_EFLG] |= flag;
+    regs[MCP_CANINTF] |= MCP_INT_ERR;
+    stats.overflowed++;
+}
+
+// Where the chip would put f: RX buffer 0 or 1, or one of these
+#define DEST_FILTERED   (-1)
+#define DEST_OVERFLOW0  (-2)            // RX0OVR
+#define DEST_OVERFLOW1  (-3)            // RX1OVR
+
+static int rx_dest(const can_frame_t *f) {
+    bool rx0_full = regs[MCP_CANINTF] & MCP_INT_RX0;
+    bool rx1_full = regs[MCP_CANINTF] & MCP_INT_RX1;
+    bool bukt = regs[MCP_RXB0CTRL] & MCP_RXB0_BUKT;
+
+    if (accepts(0, f)) {
+        if (!rx0_full)
+            return 0;
+        if (bukt)
+            return rx1_full ? DEST_OVERFLOW1 : 1;
+        return DEST_OVERFLOW0;
+    }
+    if (accepts(1, f))
+        return rx1_full ? DEST_OVERFLOW1 : 1;
+    return DEST_FILTERED;
+}
+
+void sim_mcp_bus_errors(uint8_t tec, uint8_t rec) {
+    uint8_t eflg = regs[MCP_EFLG] & (MCP_EFLG_RX0OVR | MCP_EFLG_RX1OVR);
+
+    if (tec >= 96) eflg |= MCP_EFLG_TXWAR;
+    if (rec >= 96) eflg |= MCP_EFLG_RXWAR;
+    if (tec >= 96 || rec >= 96) eflg |= MCP_EFLG_EWARN;
+    if (tec >= 128) eflg |= MCP_EFLG_TXEP;
+    if (rec >= 128) eflg |= MCP_EFLG_RXEP;
+    if (tec == 255) eflg |= MCP_EFLG_TXBO;
+
+    regs[MCP_TEC] = tec;
+    regs[MCP_REC] = rec;
+    if (eflg != regs[MCP_EFLG]) {
+        regs[MCP_EFLG] = eflg;
+        regs[MCP_CANINTF] |= MCP_INT_ERR;
+        update_int();
+    }
+}
+
+void sim_mcp_set_bus_bitrate(uint32_t bps) {
+    bus_bps = bps;
+}
+
+// Bit time = sync + PropSeg + PS1 + PS2 time quanta, TQ = 2(BRP+1)/Fosc
+uint32_t sim_mcp_bitrate(void) {
+    uint32_t brp = regs[MCP_CNF1] & 0x3F;
+    uint32_t prseg = (regs[MCP_CNF2] & 0x07) + 1;
+    uint32_t ps1 = ((regs[MCP_CNF2] >> 3) & 0x07) + 1;
+    uint32_t ps2 = (regs[MCP_CNF3] & 0x07) + 1;
+
+    // BTLMODE clear: PS2 is the greater of PS1 and the 2 TQ processing time
+    if (!(regs[MCP_CNF2] & 0x80))
+        ps2 = ps1 > 2 ? ps1 : 2;
+    return SIM_XTAL_HZ / (2 * (brp + 1) * (1 + prseg + ps1 + ps2));
+}
+
+bool sim_mcp_rx(const can_frame_t *f) {
+    uint8_t m = mode();
+    if (m != MCP_MODE_NORMAL && m != MODE_LISTEN)
+        return false;
+    if (regs[MCP_EFLG] & MCP_EFLG_TXBO)
+        return false;
+
+    stats.offered++;
+
+    if (bus_bps && sim_mcp_bitrate() != bus_bps) {
+        stats.bad_rate++;
+        if (m == MCP_MODE_NORMAL)
+            stats.error_frames++;
+        regs[MCP_CANINTF] |= MCP_INT_MERR;
+        update_int();
+        return false;
+    }
+
+    int dest = rx_dest(f);
+    switch (dest) {
+    case DEST_FILTERED:
+        stats.filtered++;
+        return false;
+    case DEST_OVERFLOW0:
+        overflow(MCP_EFLG_RX0OVR);
+        break;
+    case DEST_OVERFLOW1:
+        overflow(MCP_EFLG_RX1OVR);
+        break;
+    default:
+        load_rxb(dest, f);
+        stats.accepted++;
+        break;
+    }
+
+    update_int();
+    return dest >= 0;
+}
+
+bool sim_mcp_rx_room(const can_frame_t *f) {
+    int dest = rx_dest(f);
+    return dest != DEST_OVERFLOW0 && dest != DEST_OVERFLOW1;
+}
+
+void sim_mcp_tx_hold(bool hold) {
+    tx_hold = hold;
+}
+
+void sim_mcp_tx_release(void) {
+    bool hold = tx_hold;
+
+    tx_hold = false;
+    for (int n = 0; n < 3; n++) {
+        if (regs[MCP_TXBCTRL(n)] & MCP_TXB_TXREQ)
+            transmit(n);
+    }
+    tx_hold = hold;
+    update_int();
+}
+
+bool sim_mcp_tx_frame(can_frame_t *f) {
+    if (tx_log_tail == tx_log_head)
+        return false;
+
+    *f = tx_log[tx_log_tail++ % TX_LOG_SIZE];
+    return true;
+}
+
+uint32_t sim_mcp_int_level(void) {
+    return int_low ? 0 : 1;
+}
+
+void sim_mcp_stats(sim_mcp_stats_t *out) {
+    *out = stats;
+}
+
+// ------------------------------------------------------------
+// SPI instruction decoder: one byte in, one byte out, effects that the
+// chip applies on CS rise deferred to end_xfer()
+// ------------------------------------------------------------
+
+static bool cs_active;
+static uint8_t cmd;
+static uint32_t pos;            // bytes into the transaction
+static uint8_t addr;
+static uint8_t bitmod_mask;
+
+static void begin_xfer(void) {
+    cs_active = true;
+    pos = 0;
+    stats.spi_xfers++;
+}
+
+static uint8_t xfer_byte(uint8_t in) {
+    uint8_t out = 0xFF;
+    uint32_t i = pos++;
+
+    stats.spi_bytes++;
+
+    if (i == 0) {
+        cmd = in;
+        if (cmd == MCP_CMD_RESET) {
+            reset();
+        } else if ((cmd & 0xF9) == MCP_CMD_READ_RXB0) {
+            // READ RX BUFFER: n = bit 2, m = bit 1 (start at D0)
+            addr = ((cmd & 0x04) ? MCP_RXB1CTRL : MCP_RXB0CTRL) + ((cmd & 0x02) ? 6 : 1);
+        } else if ((cmd & 0xF8) == 0x40) {
+            // LOAD TX BUFFER: abc selects TXBn SIDH or D0
+            uint8_t abc = cmd & 0x07;
+            addr = MCP_TXBCTRL(abc >> 1) + ((abc & 1) ? 6 : 1);
+            if (regs[MCP_TXBCTRL(abc >> 1)] & MCP_TXB_TXREQ)
+                stats.tx_clobbered++;
+        } else if ((cmd & 0xF8) == 0x80) {
+            for (int n = 0; n < 3; n++) {
+                if (cmd & (1 << n))
+                    reg_write(MCP_TXBCTRL(n), reg_read(MCP_TXBCTRL(n)) | MCP_TXB_TXREQ);
+            }
+        }
+        return out;
+    }
+
+    switch (cmd) {
+    case MCP_CMD_READ:
+        if (i == 1)
+            addr = in;
+        else
+            out = reg_read(addr++);
+        break;
+    case MCP_CMD_WRITE:
+        if (i == 1)
+            addr = in;
+        else
+            reg_write(addr++, in);
+        break;
+    case MCP_CMD_BITMOD:
+        if (i == 1)
+            addr = in;
+        else if (i == 2)
+            bitmod_mask = in;
+        else if (i == 3)
+            reg_write(addr, (reg_read(addr) & ~bitmod_mask) | (in & bitmod_mask));
+        break;
+    case MCP_CMD_READSTATUS:
+        out = read_status();
+        break;
+    case CMD_RX_STATUS:
+        out = rx_status();
+        break;
+    default:
+        if ((cmd & 0xF9) == MCP_CMD_READ_RXB0)
+            out = regs[addr++ & 0x7F];
+        else if ((cmd & 0xF8) == 0x40)
+            regs[addr++ & 0x7F] = in;
+        break;
+    }
+    addr &= 0x7F;
+    return out;
+}
+
+static void end_xfer(void) {
+    // READ RX BUFFER releases the buffer when CS rises
+    if (pos > 0 && (cmd & 0xF9) == MCP_CMD_READ_RXB0)
+        regs[MCP_CANINTF] &= (cmd & 0x04) ? ~MCP_INT_RX1 : ~MCP_INT_RX0;
+
+    cs_active = false;
+    update_int();
+}
+
+// ------------------------------------------------------------
+// spi.h
+// ------------------------------------------------------------
+
+void spi_init(void) {
+    reset();
+    int_low = false;
+    int_edge = false;
+    tx_hold = false;
+    tx_log_head = tx_log_tail = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+void spi_set_clock_hz(uint32_t hz) {
+}
+
+// Async transfers run at once; completion is reported from sim_spi_poll()
+// (the host dma_poll) like the DMA completion interrupt on target
+static struct {
+    bool busy;
+    uint8_t rx[SPI_DMA_MAX];
+    uint32_t len;
+    spi_done_fn done;
+    void *ctx;
+} async;
+
+// Polled transfers wait out an async one first, like spi_wait_idle() on
+// the target: its completion, and whatever that starts, runs from here
+static void wait_idle(void) {
+    while (async.busy)
+        sim_spi_poll();
+}
+
+void spi_cs_low(void) {
+    wait_idle();
+    begin_xfer();
+}
+
+void spi_cs_high(void) {
+    end_xfer();
+}
+
+uint8_t spi_transfer(uint8_t v) {
+    return xfer_byte(v);
+}
+
+void spi_xfer(const uint8_t *tx, uint8_t *rx, uint32_t len) {
+    wait_idle();
+    begin_xfer();
+    for (uint32_t i = 0; i < len; i++) {
+        uint8_t out = xfer_byte(tx ? tx[i] : 0);
+        if (rx)
+            rx[i] = out;
+    }
+    end_xfer();
+}
+
+bool spi_xfer_async(const uint8_t *tx, uint32_t len, spi_done_fn done, void *ctx) {
+    if (async.busy || len > SPI_DMA_MAX)
+        return false;
+
+    spi_xfer(tx, async.rx, len);
+    async.busy = true;
+    async.len = len;
+    async.done = done;
+    async.ctx = ctx;
+    return true;
+}
+
+bool spi_busy(void) {
+    return async.busy;
+}
+
+// No DMA engine behind this SPI (host/sim_dma.c is the engine alone):
+// dma_poll() is where the driver collects async completions
+void dma_init(void) { }
+
+void dma_poll(void) {
+    sim_spi_poll();
+}
+
+void sim_spi_poll(void) {
+    if (!async.busy)
+        return;
+
+    async.busy = false;
+    async.done(async.rx, async.len, async.ctx);
+}
+
+// ------------------------------------------------------------
+// gpio.h: only the INT pin is modelled
+// ------------------------------------------------------------
+
+#include "gpio.h"
+
+void gpio_set_alt(uint32_t pin, uint32_t alt) { }
+void gpio_set_output(uint32_t pin) { }
+void gpio_write(uint32_t pin, uint32_t value) { }
+void gpio_set_input(uint32_t pin) { }
+void gpio_set_pull(uint32_t pin, gpio_pull_t pull) { }
+void gpio_enable_falling_edge(uint32_t pin) { }
+
+uint32_t gpio_read(uint32_t pin) {
+    return pin == MCP2515_INT_PIN ? sim_mcp_int_level() : 1;
+}
+
+uint32_t gpio_event_pending(uint32_t pin) {
+    return pin == MCP2515_INT_PIN && int_edge;
+}
+
+void gpio_clear_event(uint32_t pin) {
+    if (pin == MCP2515_INT_PIN)
+        int_edge = false;
+}
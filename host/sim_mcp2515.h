@@ -0,0 +1,56 @@
+#pragma once
+#include "mcp2515.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Simulated MCP2515 behind the spi.h / gpio.h API, for host builds.
+ *
+ * Models the register file, the SPI instruction set the driver uses
+ * (RESET, READ, WRITE, BIT MODIFY, READ STATUS, RX STATUS, READ RX
+ * BUFFER, LOAD TX BUFFER, RTS), acceptance masks and filters, RXB0
+ * rollover, RX overflow (EFLG RXnOVR + ERRIF), and the INT pin with a
+ * falling-edge latch like the GPIO event detector. Transmit requests
+ * complete at once unless held (sim_mcp_tx_hold). With a bus bitrate set, frames only arrive when the
+ * CNF registers (for a 16 MHz crystal) give the same rate; otherwise
+ * they raise MERRF, and in normal mode count as error frames the chip
+ * would have sent. SPI costs no simulated time; bytes are counted. As
+ * on the target, a polled transfer first completes an asynchronous one
+ * still in flight.
+ */
+
+typedef struct {
+    uint64_t offered;       // frames put on the simulated bus
+    uint64_t accepted;      // loaded into RXB0/RXB1
+    uint64_t filtered;      // rejected by masks and filters
+    uint64_t overflowed;    // accepted but no free RX buffer (lost)
+    uint64_t bad_rate;      // seen at the wrong bitrate (MERRF)
+    uint64_t error_frames;  // of those, in normal mode: error frames sent
+    uint64_t transmitted;   // TX requests completed
+    uint64_t tx_clobbered;  // TX buffers loaded while their TXREQ was set
+    uint64_t spi_bytes;     // bytes clocked over SPI
+    uint64_t spi_xfers;     // chip-select assertions
+} sim_mcp_stats_t;
+
+/* Put a frame on the bus; false if it was filtered or lost to overflow */
+bool sim_mcp_rx(const can_frame_t *f);
+/* False if f, offered now, would be lost to RX overflow */
+bool sim_mcp_rx_room(const can_frame_t *f);
+/* Bitrate of the simulated bus; 0 (the default) matches any setting */
+void sim_mcp_set_bus_bitrate(uint32_t bps);
+/* Bitrate the CNF registers currently give */
+uint32_t sim_mcp_bitrate(void);
+/* Leave transmit requests pending (TXREQ set) until released */
+void sim_mcp_tx_hold(bool hold);
+/* Complete the pending transmit requests now */
+void sim_mcp_tx_release(void);
+/* Oldest transmitted frame not yet taken; false if none */
+bool sim_mcp_tx_frame(can_frame_t *f);
+
+/* INT pin level: 0 = asserted */
+uint32_t sim_mcp_int_level(void);
+
+void sim_mcp_stats(sim_mcp_stats_t *out);
+
+/* Run completion callbacks of SPI transfers started asynchronously */
+void sim_spi_poll(void);
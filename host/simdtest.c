@@ -0,0 +1,152 @@
+// Draws the same operations through the scalar and the FB_SIMD build of
+// the framebuffer (fb_variant.h) and compares the surfaces word for word
+// after each one. Offsets, widths and surface bases are chosen to land
+// the spans on every alignment, so the SIMD heads and tails are covered
+// as well as the vector bodies.
+
+#include "fb_variant.h"
+#include <stdio.h>
+#include <string.h>
+
+#define W       101         // odd: every row starts on a different alignment
+#define H       37
+#define GUARD   4           // words either side, to catch overruns
+#define WORDS   (GUARD + W * H + 3 + GUARD)
+
+static const fb_variant_t *const variants[2] = { &fb_scalar, &fb_simd };
+
+// Per variant: the destination, plus a source for the blits
+static uint32_t dst_mem[2][WORDS] __attribute__((aligned(16)));
+static uint32_t src_mem[2][WORDS] __attribute__((aligned(16)));
+static framebuffer_t dst[2], src[2];
+
+static uint32_t cases, failures;
+
+static uint32_t rng = 1;
+
+static uint32_t next_rand(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+// Same random contents in both variants; skew (0-3 pixels) moves the
+// surface base off 16-byte alignment
+static void reset(uint32_t skew, uint32_t key) {
+    for (uint32_t i = 0; i < WORDS; i++) {
+        uint32_t d = next_rand();
+        uint32_t s = next_rand();
+        if ((s & 3) == 0)
+            s = key;            // a quarter of the source is transparent
+        for (int v = 0; v < 2; v++) {
+            dst_mem[v][i] = d;
+            src_mem[v][i] = s;
+        }
+    }
+    for (int v = 0; v < 2; v++) {
+        variants[v]->init_surface(&dst[v], dst_mem[v] + GUARD + skew, W, H);
+        variants[v]->init_surface(&src[v], src_mem[v] + GUARD + (3 - skew), W, H);
+    }
+}
+
+static void compare(const char *op, int32_t a, int32_t b, int32_t c, int32_t d) {
+    cases++;
+    if (!memcmp(dst_mem[0], dst_mem[1], sizeof(dst_mem[0])))
+        return;
+
+    uint32_t i = 0;
+    while (dst_mem[0][i] == dst_mem[1][i])
+        i++;
+    printf("FAIL %-10s (%d, %d, %d, %d): word %u scalar %08x simd %08x\n",
+           op, a, b, c, d, i, dst_mem[0][i], dst_mem[1][i]);
+    failures++;
+
+    // Carry on from identical surfaces
+    memcpy(dst_mem[1], dst_mem[0], sizeof(dst_mem[0]));
+}
+
+static void set_clip(const fb_rect_t *r) {
+    for (int v = 0; v < 2; v++)
+        variants[v]->set_clip(&dst[v], r);
+}
+
+// Span widths around each vector size and unroll, plus full rows
+static const int32_t widths[] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 12, 15, 16, 17, 19, 20, 31, 32, 33, 47, 63, 64, 65, W
+};
+#define NUM_WIDTHS (sizeof(widths) / sizeof(widths[0]))
+
+static void test_fill(void) {
+    for (int32_t x = 0; x < 9; x++) {
+        for (uint32_t i = 0; i < NUM_WIDTHS; i++) {
+            int32_t w = widths[i];
+            int32_t y = (x * 5 + i) % H;
+            uint32_t color = next_rand();
+
+            for (int v = 0; v < 2; v++)
+                variants[v]->fill_rect(&dst[v], x, y, w, 3, color);
+            compare("fill", x, y, w, 3);
+        }
+    }
+}
+
+static void test_copy(bool keyed, uint32_t key) {
+    for (int32_t sx = 0; sx < 8; sx++) {
+        for (int32_t dx = -3; dx < 8; dx++) {
+            for (uint32_t i = 0; i < NUM_WIDTHS; i += 2) {
+                int32_t w = widths[i];
+                int32_t sy = (sx * 3 + i) % H;
+                int32_t dy = (dx * 7 + i + 10) % H;
+
+                for (int v = 0; v < 2; v++) {
+                    if (keyed)
+                        variants[v]->blit_keyed(&dst[v], dx, dy, &src[v], sx, sy, w, 2, key);
+                    else
+                        variants[v]->copy_rect(&dst[v], dx, dy, &src[v], sx, sy, w, 2);
+                }
+                compare(keyed ? "blit_keyed" : "copy", dx, sx, w, dy);
+            }
+        }
+    }
+}
+
+static void test_text(void) {
+    static const char *const strs[] = {
+        "A", "Hi", "0123456789", "The quick brown fox~", "\x01{|}\x7f"
+    };
+
+    for (uint32_t s = 0; s < sizeof(strs) / sizeof(strs[0]); s++) {
+        // Both edges of the screen, and every sub-vector offset in between
+        for (int32_t x = -19; x < W + 3; x += (x > 12 && x < W - 30) ? 13 : 1) {
+            int32_t y = (x + 40) % (H - 6) - 4;
+            uint32_t fg = next_rand(), bg = next_rand();
+
+            for (int v = 0; v < 2; v++)
+                variants[v]->draw_text_bg(&dst[v], x, y, strs[s], fg, bg);
+            compare("text_bg", x, y, (int32_t)s, 0);
+        }
+    }
+}
+
+int main(void) {
+    const uint32_t key = 0x00FF00FF;
+    // Odd clip edges, so clipping also cuts spans mid-vector
+    const fb_rect_t clip = { 3, 2, W - 8, H - 5 };
+
+    for (uint32_t skew = 0; skew < 4; skew++) {
+        for (int clipped = 0; clipped < 2; clipped++) {
+            reset(skew, key);
+            set_clip(clipped ? &clip : 0);
+
+            test_fill();
+            test_copy(false, key);
+            test_copy(true, key);
+            test_text();
+        }
+    }
+
+    printf("simdtest %s  %u cases  %u mismatches\n",
+           failures ? "FAIL" : "ok", cases, failures);
+    return failures != 0;
+}
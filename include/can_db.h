@@ -0,0 +1,47 @@
+// Generated by tools/dbc2c.py from dbc/dash.dbc -- do not edit
+#pragma once
+#include "can_signals.h"
+
+// Message IDs in can_frame_t encoding
+#define CAN_MSG_EEC1 0x8CFF1234u
+#define CAN_MSG_ET1 0x98FEEE00u
+#define CAN_MSG_WHEEL_SPEEDS 0x00000500u
+#define CAN_MSG_BODY_STATUS 0x00000600u
+#define CAN_MSG_STEERING_ANGLE 0x00000610u
+
+// Slots in sig_values[], in 1/SIG_SCALE of the unit shown
+enum {
+    SIG_EEC1_ENGINE_SPEED,            // rpm
+    SIG_EEC1_ENGINE_LOAD,             // %
+    SIG_EEC1_THROTTLE_POS,            // %
+    SIG_ET1_COOLANT_TEMP,             // degC
+    SIG_ET1_OIL_TEMP,                 // degC
+    SIG_ET1_OIL_PRESSURE,             // kPa
+    SIG_WHEEL_SPEEDS_WHEEL_FL,        // km/h
+    SIG_WHEEL_SPEEDS_WHEEL_FR,        // km/h
+    SIG_WHEEL_SPEEDS_WHEEL_RL,        // km/h
+    SIG_WHEEL_SPEEDS_WHEEL_RR,        // km/h
+    SIG_BODY_STATUS_BATTERY_VOLTAGE,  // V
+    SIG_BODY_STATUS_BATTERY_CURRENT,  // A
+    SIG_BODY_STATUS_FUEL_LEVEL,       // %
+    SIG_STEERING_ANGLE_ANGLE,         // deg
+    SIG_COUNT
+};
+
+#define CAN_DB_NUM_MESSAGES 5
+
+// Perfect hash, see can_db_find():
+//   b    = (id * MULT1) >> (32 - BUCKET_BITS)
+//   slot = ((id * MULT2) >> (32 - BITS)) + disp[b], mod 2^BITS
+#define CAN_DB_HASH_BITS        3
+#define CAN_DB_HASH_BUCKET_BITS 2
+#define CAN_DB_HASH_MULT1       0x4EDC7D59u
+#define CAN_DB_HASH_MULT2       0x15DB1E15u
+#define CAN_DB_HASH_EMPTY       0xFF
+typedef uint8_t can_db_slot_t;
+typedef uint8_t can_db_disp_t;
+
+extern const can_msg_def_t can_db_messages[CAN_DB_NUM_MESSAGES];
+extern const can_signal_t can_db_signals[SIG_COUNT];
+extern const can_db_disp_t can_db_hash_disp[1 << CAN_DB_HASH_BUCKET_BITS];
+extern const can_db_slot_t can_db_hash[1 << CAN_DB_HASH_BITS];
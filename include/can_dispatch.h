@@ -0,0 +1,21 @@
+#pragma once
+#include "can_signals.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Per-message routing on top of the signal DB. A frame is looked up
+ * through the DB's perfect hash, decoded into sig_values[], then handed
+ * to the handler registered for its ID. IDs outside the DB are rejected
+ * after one hash probe and one compare.
+ */
+
+typedef void (*can_handler_fn)(const can_frame_t *f, const can_msg_def_t *m, void *ctx);
+
+/* Attach fn to a DB message (one handler per message; re-registering
+ * replaces it). False if id is not in the DB. */
+bool can_dispatch_register(uint32_t id, can_handler_fn fn, void *ctx);
+
+/* Decode f and run its handler. Returns the message, or NULL if the ID
+ * is not in the DB or the frame is too short. */
+const can_msg_def_t *can_dispatch(const can_frame_t *f);
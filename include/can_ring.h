@@ -0,0 +1,50 @@
+#pragma once
+#include "mcp2515.h"
+#include "mmu.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Single-producer / single-consumer ring of timestamped CAN frames.
+ *
+ * Lock-free: the producer only writes head, the consumer only writes
+ * tail, and both are published with release/acquire ordering, so the
+ * ring works between an ISR and the main loop as well as between cores.
+ * Producer and consumer state sit on separate cache lines.
+ */
+
+#define CAN_RING_SIZE   256     // power of two
+
+typedef struct {
+    uint64_t ts;                // µs receive time (system timer, at the INT edge)
+    can_frame_t frame;
+} can_rx_t;
+
+typedef struct can_ring {
+    // Producer-owned
+    uint32_t head __attribute__((aligned(CACHE_LINE)));
+    uint32_t dropped;           // pushes refused because the ring was full
+    uint32_t high_water;        // deepest fill level seen
+
+    // Consumer-owned
+    uint32_t tail __attribute__((aligned(CACHE_LINE)));
+
+    can_rx_t slots[CAN_RING_SIZE] __attribute__((aligned(CACHE_LINE)));
+} can_ring_t;
+
+void can_ring_init(can_ring_t *r);
+
+/* Producer: copy a frame in; false (and counted as dropped) when full */
+bool can_ring_push(can_ring_t *r, const can_frame_t *f, uint64_t ts);
+
+/* Consumer: point *batch at the oldest frames, in place. Returns how many
+ * are contiguous (up to the wrap point); release them with consume. */
+uint32_t can_ring_peek(can_ring_t *r, const can_rx_t **batch);
+void can_ring_consume(can_ring_t *r, uint32_t n);
+
+/* Consumer: copy out a single frame */
+bool can_ring_pop(can_ring_t *r, can_rx_t *out);
+
+uint32_t can_ring_count(const can_ring_t *r);
+uint32_t can_ring_dropped(const can_ring_t *r);
+uint32_t can_ring_high_water(const can_ring_t *r);
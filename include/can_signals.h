@@ -0,0 +1,50 @@
+#pragma once
+#include "mcp2515.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Table-driven CAN signal decoding.
+ *
+ * The tables come from a DBC file via tools/dbc2c.py (src/can_db.c,
+ * include/can_db.h). Each signal is a shift and mask into the frame
+ * payload read as one 64-bit word, little-endian for Intel signals and
+ * big-endian for Motorola ones, followed by an integer scale. Decoded
+ * values land in sig_values[], indexed by the generated SIG_* enum, in
+ * 1/SIG_SCALE physical units (e.g. millivolts for a "V" signal).
+ */
+
+#define SIG_SCALE       1000
+
+// can_signal_t.flags
+#define SIG_BIG_ENDIAN  0x01    // Motorola byte order
+#define SIG_SIGNED      0x02    // two's complement raw value
+
+typedef struct {
+    uint8_t  shift;             // LSB position in the payload word
+    uint8_t  len;               // bits, 1..64
+    uint8_t  flags;
+    int32_t  num;               // value = raw * num / den + offset
+    uint32_t den;
+    int32_t  offset;
+    int32_t  min, max;          // clamp, in scaled units
+} can_signal_t;
+
+typedef struct {
+    uint32_t id;                // can_frame_t encoding
+    uint8_t  dlc;               // frames shorter than this are ignored
+    uint16_t first;             // first entry in can_db_signals[]
+    uint16_t count;
+} can_msg_def_t;
+
+extern int32_t sig_values[];
+
+/* Look up the message definition for a CAN ID in O(1); NULL if not in
+ * the DB */
+const can_msg_def_t *can_db_find(uint32_t id);
+
+/* Decode every signal of f into sig_values[]. Returns the message that
+ * was decoded, or NULL if the ID is unknown or the frame is too short. */
+const can_msg_def_t *can_decode(const can_frame_t *f);
+/* Same, for a message already looked up; false if f is too short */
+bool can_decode_msg(const can_msg_def_t *m, const can_frame_t *f);
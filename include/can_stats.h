@@ -0,0 +1,64 @@
+#pragma once
+#include "mcp2515.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Per-ID receive statistics and bus load.
+ *
+ * can_stats_record() is O(1) and shift-only: an open-addressed table keyed
+ * by CAN ID, min/max period, and shift-based EWMAs of the period and its
+ * jitter. Anything needing a divide (mean period, rate, bus load) is
+ * computed when queried or on the once-a-window tick.
+ */
+
+#define CAN_STATS_SLOT_BITS 7           // 128 slots; IDs past this are untracked
+#define CAN_STATS_SLOTS     (1 << CAN_STATS_SLOT_BITS)
+#define CAN_STATS_WINDOW_US 1000000     // bus load averaging window
+#define CAN_STATS_EWMA_SHIFT 4          // EWMA weight 1/16
+
+typedef struct {
+    uint32_t id;                // can_frame_t encoding
+    uint32_t count;             // 0: slot unused
+    uint64_t first_ts;          // µs
+    uint64_t last_ts;
+    uint32_t min_period;        // µs between frames
+    uint32_t max_period;
+    uint32_t avg_q;             // EWMA period << CAN_STATS_EWMA_SHIFT
+    uint32_t jitter_q;          // EWMA |period - avg| << CAN_STATS_EWMA_SHIFT
+    uint8_t  dlc;               // last DLC seen
+    uint32_t dlc_changes;
+} can_id_stats_t;
+
+void can_stats_init(mcp_bitrate_t br);
+
+/* Account one received frame with its receive timestamp (µs) */
+void can_stats_record(const can_frame_t *f, uint64_t ts);
+/* Close the bus load window when it has elapsed; call from the main loop */
+void can_stats_tick(uint64_t now);
+
+/* The slot table, CAN_STATS_SLOTS entries; skip entries with count == 0 */
+const can_id_stats_t *can_stats_table(void);
+uint32_t can_stats_ids(void);           // IDs being tracked
+uint32_t can_stats_untracked(void);     // frames whose ID found no free slot
+
+/* Exact mean period over the whole capture, µs; 0 before two frames */
+uint32_t can_stats_mean_period(const can_id_stats_t *s);
+static inline uint32_t can_stats_jitter(const can_id_stats_t *s) {
+    return s->jitter_q >> CAN_STATS_EWMA_SHIFT;
+}
+
+/* Bus utilisation over the last complete window, in 0.1% units */
+uint32_t can_stats_bus_load(void);
+/* Frames per second over the last complete window, all IDs */
+uint32_t can_stats_bus_fps(void);
+
+/* Text rendering shared by the UART dump and the on-screen page; buf
+ * needs CAN_STATS_LINE_MAX bytes, the result is NUL-terminated */
+#define CAN_STATS_LINE_MAX  80
+extern const char can_stats_header[];
+int can_stats_fmt_row(char *buf, const can_id_stats_t *s);
+int can_stats_fmt_summary(char *buf);
+
+/* Print the summary and table to the UART */
+void can_stats_dump(void);
@@ -0,0 +1,53 @@
+#pragma once
+#include "framebuffer.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Damage-tracking compositor.
+ *
+ * Widgets own a rectangle on screen and a draw callback. When a widget's
+ * content changes it marks the affected area dirty with comp_damage();
+ * comp_flush() then repaints only the dirty rectangles, calling each
+ * widget that overlaps them with the framebuffer clip set to the damage.
+ *
+ * Damage can be added from any core; flushes must all come from one.
+ * Change widget state first and damage after, so a flush that paints
+ * mid-change is followed by one that repairs it.
+ *
+ * Draw callbacks run while the framebuffer is batching (fb_dlist.h): what
+ * they draw is rasterized across the cores after the last one returns,
+ * so any surface they blit from must stay unchanged until the flush ends.
+ */
+
+#define COMP_MAX_WIDGETS  8
+#define COMP_MAX_DAMAGE   16
+
+typedef void (*widget_draw_fn)(framebuffer_t *fb, const fb_rect_t *clip, void *ctx);
+
+typedef struct {
+    fb_rect_t bounds;
+    widget_draw_fn draw;
+    void *ctx;
+    bool opaque;        // draw covers every pixel of bounds, no background clear needed
+    bool hidden;        // skipped by the compositor, see comp_show_widget()
+} widget_t;
+
+void comp_init(framebuffer_t *fb, uint32_t bg);
+bool comp_add_widget(widget_t *w);
+/* Show or hide a widget; the area it covers is repainted */
+void comp_show_widget(widget_t *w, bool show);
+
+/* Mark an area dirty (clipped to the screen) */
+void comp_damage(const fb_rect_t *r);
+void comp_damage_widget(const widget_t *w);
+void comp_damage_all(void);
+
+/* fn runs, on the damaging core, whenever damage lands on an empty
+ * list: once per flush at most, to wake whoever flushes */
+typedef void (*comp_notify_fn)(void *ctx);
+void comp_on_damage(comp_notify_fn fn, void *ctx);
+
+/* Repaint all damaged areas into the back buffer and flip it on screen;
+ * returns the number of pixels repainted */
+uint32_t comp_flush(void);
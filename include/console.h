@@ -0,0 +1,16 @@
+#pragma once
+#include <stdbool.h>
+
+/*
+ * Line-based command console on UART0. console_poll() drains the RX FIFO
+ * without blocking; a completed line runs the command registered under
+ * its first word, with the rest of the line as args.
+ */
+
+#define CONSOLE_MAX_CMDS  8
+#define CONSOLE_LINE_MAX  64
+
+typedef void (*console_cmd_fn)(const char *args);
+
+bool console_register(const char *name, console_cmd_fn fn);
+void console_poll(void);
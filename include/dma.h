@@ -0,0 +1,59 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Channels the firmware leaves to the ARM (dma.channelmask 0x7F35)
+#define DMA_CH_SPI_TX   4
+#define DMA_CH_SPI_RX   5
+#define DMA_NUM_CH      15
+
+// Peripheral DREQ lines
+#define DMA_DREQ_SPI_TX 6
+#define DMA_DREQ_SPI_RX 7
+
+// Transfer information (TI) bits
+#define DMA_TI_INTEN        (1u << 0)
+#define DMA_TI_WAIT_RESP    (1u << 3)
+#define DMA_TI_DEST_INC     (1u << 4)
+#define DMA_TI_DEST_DREQ    (1u << 6)
+#define DMA_TI_SRC_INC      (1u << 8)
+#define DMA_TI_SRC_DREQ     (1u << 10)
+#define DMA_TI_PERMAP(n)    ((uint32_t)(n) << 16)
+#define DMA_TI_NO_WIDE      (1u << 26)
+
+/* Control block: 32-byte aligned, chained through nextconbk (bus address) */
+typedef struct {
+    uint32_t ti;
+    uint32_t source_ad;
+    uint32_t dest_ad;
+    uint32_t txfr_len;
+    uint32_t stride;
+    uint32_t nextconbk;
+    uint32_t reserved[2];
+} __attribute__((aligned(32))) dma_cb_t;
+
+typedef void (*dma_done_fn)(uint32_t ch, bool error, void *ctx);
+
+void dma_init(void);
+
+/* Bus addresses as seen by the DMA engine */
+uint32_t dma_bus_addr(const volatile void *p);       // RAM (uncached alias)
+uint32_t dma_periph_bus_addr(uintptr_t phys);        // peripheral register
+
+/* Point cb at the next block in its chain (NULL ends the chain) */
+void dma_cb_chain(dma_cb_t *cb, const dma_cb_t *next);
+
+/* Start the chain at cb (ncb blocks, contiguous); done runs once the
+ * last block with INTEN ends. Control blocks are cleaned from the
+ * D-cache here. A chain whose last block lacks INTEN is fire-and-forget:
+ * done never runs and dma_busy() stays false, so its end must be known
+ * some other way (the SPI TX channel ends before its paired RX). */
+void dma_start(uint32_t ch, dma_cb_t *cb, uint32_t ncb, dma_done_fn done, void *ctx);
+bool dma_busy(uint32_t ch);
+void dma_abort(uint32_t ch);
+
+/* Completion service for channel ch; dma_init() hooks it to IRQ_DMA(ch) */
+void dma_irq_handler(uint32_t ch);
+/* Service every channel whose interrupt flag is set, for callers with
+ * IRQs masked */
+void dma_poll(void);
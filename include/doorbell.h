@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Inter-core doorbells on the ARM-local mailboxes.
+ *
+ * Each core has a 32-bit doorbell word (its local mailbox 0). Any core
+ * rings it by setting bits; the owner takes and clears them. Ringing
+ * orders the ringer's earlier stores before the bell and sends an event,
+ * so a core sleeping in WFE, or taking IRQ_DOORBELL once it has
+ * irq_enable()d it (irq.h), sees the data the bell announces.
+ * Under HOST_SIM the words live in memory, one per host thread.
+ */
+
+#define DOORBELL_WAKE   (1u << 0)   // just look for work
+
+void doorbell_ring(uint32_t core, uint32_t bits);
+
+/* Bits rung for core since the last take, cleared */
+uint32_t doorbell_take(uint32_t core);
@@ -0,0 +1,69 @@
+#pragma once
+#include "framebuffer.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Display list: deferred drawing for tile-parallel rasterization.
+ *
+ * Between fb_batch_begin() and fb_batch_end() the fb_* draw calls on
+ * that framebuffer record a command instead of touching pixels. Each
+ * command keeps the clip rectangle in force when it was recorded, cut
+ * down to the area the draw can reach, and text is copied into the
+ * list, so callers may reuse their buffers at once. fb_batch_end() (or
+ * a full list) replays the commands band by band through fb_tiles_run(),
+ * each band clipping every command to its own rows; the output is
+ * pixel-identical to drawing directly.
+ *
+ * Surfaces passed to fb_copy_rect()/fb_blit_keyed() are read at replay,
+ * so they must not change before the batch ends.
+ */
+
+#define FB_DL_MAX_CMDS  512
+#define FB_DL_TEXT      8192    // bytes of copied strings per list
+
+enum {
+    FB_OP_PIXEL,
+    FB_OP_FILL,
+    FB_OP_COPY,
+    FB_OP_BLIT_KEYED,
+    FB_OP_CHAR,
+    FB_OP_TEXT,
+    FB_OP_TEXT_BG,
+    FB_OP_LINE,
+    FB_OP_ARC,
+};
+
+typedef struct {
+    uint8_t op;
+    fb_rect_t clip;             // recording clip, limited to what the draw covers
+    int32_t arg[6];             // coordinates, in fb_* argument order
+    uint32_t color;             // colour, fg or colour key
+    uint32_t bg;
+    const framebuffer_t *src;   // FB_OP_COPY / FB_OP_BLIT_KEYED
+    uint32_t text;              // offset of the string in the text pool
+} fb_cmd_t;
+
+typedef struct fb_dlist {
+    fb_cmd_t cmds[FB_DL_MAX_CMDS];
+    uint32_t count;
+    char text[FB_DL_TEXT];
+    uint32_t text_used;
+} fb_dlist_t;
+
+/* Start recording draws on fb into dl (replaces any running batch) */
+void fb_batch_begin(framebuffer_t *fb, fb_dlist_t *dl);
+
+/* Rasterize everything recorded and go back to drawing directly */
+void fb_batch_end(framebuffer_t *fb);
+
+/* Rasterize what is recorded so far and keep batching */
+void fb_dl_flush(framebuffer_t *fb);
+
+/* Drop what is recorded so far, e.g. when it is about to be painted over */
+void fb_dl_discard(framebuffer_t *fb);
+
+/* Used by the fb_* draw calls: record cmd if any of bounds is inside the
+ * current clip. s, if not NULL, is copied to the text pool. */
+void fb_dl_add(framebuffer_t *fb, fb_cmd_t *cmd, const fb_rect_t *bounds,
+               const char *s);
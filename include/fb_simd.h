@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * Pixel span kernels used by the framebuffer.
+ *
+ * Built with FB_SIMD (make SIMD=1) these use AdvSIMD; otherwise they are
+ * plain scalar loops. Both paths produce identical output.
+ */
+
+void fb_span_fill(uint32_t *dst, uint32_t color, uint32_t n);
+void fb_span_copy(uint32_t *dst, const uint32_t *src, uint32_t n);
+/* Masked blit: copy src pixels that are not equal to key */
+void fb_span_blit_keyed(uint32_t *dst, const uint32_t *src, uint32_t key, uint32_t n);
+
+#if defined(FB_SIMD) && defined(__ARM_NEON)
+#include <arm_neon.h>
+
+/* One glyph row: 8 pixels selected between fg and bg by mask m */
+static inline void fb_glyph8(uint32_t *p, const uint32_t *m, uint32_t fg, uint32_t bg) {
+    uint32x4_t f = vdupq_n_u32(fg);
+    uint32x4_t b = vdupq_n_u32(bg);
+    vst1q_u32(p, vbslq_u32(vld1q_u32(m), f, b));
+    vst1q_u32(p + 4, vbslq_u32(vld1q_u32(m + 4), f, b));
+}
+#else
+static inline void fb_glyph8(uint32_t *p, const uint32_t *m, uint32_t fg, uint32_t bg) {
+    uint32_t diff = fg ^ bg;
+    p[0] = bg ^ (diff & m[0]);
+    p[1] = bg ^ (diff & m[1]);
+    p[2] = bg ^ (diff & m[2]);
+    p[3] = bg ^ (diff & m[3]);
+    p[4] = bg ^ (diff & m[4]);
+    p[5] = bg ^ (diff & m[5]);
+    p[6] = bg ^ (diff & m[6]);
+    p[7] = bg ^ (diff & m[7]);
+}
+#endif
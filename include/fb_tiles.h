@@ -0,0 +1,30 @@
+#pragma once
+#include "framebuffer.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Band-parallel rasterization.
+ *
+ * fb_tiles_run() cuts the surface into horizontal bands of FB_TILE_ROWS
+ * rows and hands them out one at a time through an atomic counter. Any
+ * core (or host thread) that calls fb_tiles_help() takes a band and
+ * draws it; the caller of fb_tiles_run() draws bands too and returns
+ * once every band is done. Bands never share a pixel row, so drawing
+ * inside one needs no locking. Without helpers the caller draws them all.
+ * Starting a job rings every core's doorbell, so helpers can sleep.
+ *
+ * One job at a time: fb_tiles_run() must only be called from one core.
+ */
+
+#define FB_TILE_ROWS  32    // 15 bands at 480 rows: small enough to balance
+
+/* Draw the part of a job inside band (full width, FB_TILE_ROWS tall or
+ * less at the bottom) into fb */
+typedef void (*fb_band_fn)(const framebuffer_t *fb, const fb_rect_t *band, void *ctx);
+
+void fb_tiles_run(const framebuffer_t *fb, fb_band_fn fn, void *ctx);
+
+/* Draw one band of the running job, if any is left; false when idle.
+ * Cheap enough to call on every pass of a polling loop. */
+bool fb_tiles_help(void);
@@ -0,0 +1,14 @@
+#pragma once
+#include <stdint.h>
+
+/* Number and string formatting without libc; each returns the characters
+ * written and does not NUL-terminate */
+
+int fmt_u32_dec(char *buf, uint32_t v);
+/* Right-aligned in a field of at least width characters */
+int fmt_u32_dec_w(char *buf, uint32_t v, int width);
+/* Zero-padded to at least width digits */
+int fmt_u32_dec_z(char *buf, uint32_t v, int width);
+int fmt_u32_hex(char *buf, uint32_t v, int width);
+/* Copies a NUL-terminated string; the caller sizes buf for it */
+int fmt_str(char *buf, const char *s);
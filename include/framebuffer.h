@@ -2,22 +2,64 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+typedef struct {
+    int32_t x;
+    int32_t y;
+    int32_t w;
+    int32_t h;
+} fb_rect_t;
+
 typedef struct {
     uint32_t width;
     uint32_t height;
     uint32_t pitch;
     uint32_t is_rgb;
-    volatile uint8_t *buf;
+    volatile uint8_t *buf;      // back buffer: all drawing goes here
+    fb_rect_t clip;             // all drawing is clipped to this rectangle
+    volatile uint8_t *pages[2]; // page 0 = top half of the virtual screen
+    uint32_t num_pages;         // 2 when double buffered
+    uint32_t back;              // index of the page being drawn
+    struct fb_dlist *dl;        // set while batching: draws are recorded (fb_dlist.h)
 } framebuffer_t;
 
+/* Allocates a 2x tall virtual screen for double buffering when the
+ * firmware allows it, otherwise falls back to a single buffer. */
 bool fb_init(framebuffer_t *fb, uint32_t w, uint32_t h, uint32_t depth);
 
+/* Scan out the back buffer at the next vsync and start drawing into the
+ * other page. No-op when single buffered. */
+void fb_swap(framebuffer_t *fb);
+
+/* Wrap caller-provided memory (w * h 32-bit pixels) as an offscreen surface */
+void fb_init_surface(framebuffer_t *fb, uint32_t *mem, uint32_t w, uint32_t h);
+
+/* Restrict drawing to r (intersected with the screen); NULL resets to full screen */
+void fb_set_clip(framebuffer_t *fb, const fb_rect_t *r);
+
+/* Rectangle helpers */
+bool fb_rect_intersect(const fb_rect_t *a, const fb_rect_t *b, fb_rect_t *out);
+void fb_rect_union(const fb_rect_t *a, const fb_rect_t *b, fb_rect_t *out);
+bool fb_rect_contains(const fb_rect_t *outer, const fb_rect_t *inner);
+
+/* Fill every page, split into bands across the tile workers (fb_tiles.h) */
 void fb_clear(framebuffer_t *fb, uint32_t color);
 void fb_put_pixel(framebuffer_t *fb, uint32_t x, uint32_t y, uint32_t color);
 void fb_fill_rect(framebuffer_t *fb, uint32_t x, uint32_t y,
                   uint32_t w, uint32_t h, uint32_t color);
+/* Copy a block from another surface, clipped to fb's clip rectangle */
+void fb_copy_rect(framebuffer_t *fb, int32_t dx, int32_t dy,
+                  const framebuffer_t *src, int32_t sx, int32_t sy,
+                  int32_t w, int32_t h);
+/* As fb_copy_rect, but source pixels equal to key are left transparent */
+void fb_blit_keyed(framebuffer_t *fb, int32_t dx, int32_t dy,
+                   const framebuffer_t *src, int32_t sx, int32_t sy,
+                   int32_t w, int32_t h, uint32_t key);
 void fb_draw_char(framebuffer_t *fb, uint32_t x, uint32_t y, char c, uint32_t color);
 void fb_draw_text(framebuffer_t *fb, uint32_t x, uint32_t y, const char *s, uint32_t color);
+/* Opaque text: draws glyph background too, so no clear is needed first.
+ * Clips once per string and writes whole rows of pixels. */
+void fb_draw_text_bg(framebuffer_t *fb, int32_t x, int32_t y, const char *s,
+                     uint32_t fg, uint32_t bg);
 
 /* Draw a line (Bresenham) */
 void fb_draw_line(framebuffer_t *fb, int x0, int y0, int x1, int y1, uint32_t color);
@@ -1,4 +1,21 @@
 #pragma once
 #include "framebuffer.h"
+#include "compositor.h"
+#include <stdbool.h>
 
-void draw_rpm_gauge(framebuffer_t *fb, int cx, int cy, int r, int rpm);
+#define RPM_GAUGE_MAX      8000
+#define RPM_GAUGE_REDLINE  6500
+
+typedef struct {
+    widget_t widget;
+    int cx, cy, r;
+    int rpm;
+    int needle_x, needle_y;     // current needle tip
+    framebuffer_t face;         // pre-rendered arc, ticks, labels and redline
+} rpm_gauge_t;
+
+/* Renders the gauge face once into an offscreen surface; fails if the
+ * face pool has no room for a gauge of radius r */
+bool rpm_gauge_init(rpm_gauge_t *g, int cx, int cy, int r);
+/* Move the needle; damages only the old and new needle extents */
+void rpm_gauge_set(rpm_gauge_t *g, int rpm);
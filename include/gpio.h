@@ -4,3 +4,18 @@
 void gpio_set_alt(uint32_t pin, uint32_t alt);
 void gpio_set_output(uint32_t pin);
 void gpio_write(uint32_t pin, uint32_t value);
+
+typedef enum {
+    GPIO_PULL_NONE = 0,
+    GPIO_PULL_DOWN = 1,
+    GPIO_PULL_UP   = 2
+} gpio_pull_t;
+
+void gpio_set_input(uint32_t pin);
+void gpio_set_pull(uint32_t pin, gpio_pull_t pull);
+uint32_t gpio_read(uint32_t pin);
+
+// Edge detection (bank 0 pins, raise gpio_int[0] / IRQ 49 when enabled)
+void gpio_enable_falling_edge(uint32_t pin);
+uint32_t gpio_event_pending(uint32_t pin);
+void gpio_clear_event(uint32_t pin);
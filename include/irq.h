@@ -0,0 +1,109 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Interrupts on the BCM2837: the ARM-local controller at 0x40000000
+ * (per-core timers, mailboxes, and the GPU line) in front of the legacy
+ * controller at 0x3F00B200 (peripheral IRQs 0-63 and the basic ARM
+ * sources). There is no GIC.
+ *
+ * Every source has one number below. start.S saves the caller-saved
+ * context and calls irq_dispatch(), which reads the core's local source
+ * register and, for the GPU line, the legacy pending registers, and
+ * runs each pending source's handler from a table indexed by number:
+ * one count-trailing-zeros per pending source, however many are
+ * registered. Handlers run with IRQs masked and must clear their source.
+ *
+ * Peripheral IRQs go to one core, picked with irq_route_gpu(). Local
+ * sources are enabled per core: irq_enable() on one of them affects the
+ * calling core only.
+ */
+
+// Legacy controller: peripheral IRQs 0-63
+#define IRQ_DMA(ch)         (16 + (ch))         // channels 0-12
+#define IRQ_AUX             29
+#define IRQ_GPIO(bank)      (49 + (bank))       // gpio_int[0-3]
+#define IRQ_SPI             54
+#define IRQ_UART            57
+
+// Legacy controller: basic pending bits 0-7
+#define IRQ_ARM_TIMER       64
+#define IRQ_ARM_MAILBOX     65
+
+// ARM-local sources, by bit of the core's IRQ source register
+#define IRQ_LOCAL(bit)      (72 + (bit))
+#define IRQ_CNTPNS          IRQ_LOCAL(1)        // EL1 physical timer
+#define IRQ_CNTV            IRQ_LOCAL(3)        // virtual timer
+#define IRQ_MAILBOX(m)      IRQ_LOCAL(4 + (m))  // core mailbox 0-3
+#define IRQ_DOORBELL        IRQ_MAILBOX(0)      // see doorbell.h
+#define IRQ_PMU             IRQ_LOCAL(9)
+#define IRQ_LOCAL_TIMER     IRQ_LOCAL(11)
+
+#define IRQ_NUM             84
+
+typedef void (*irq_fn)(uint32_t irq, void *ctx);
+
+typedef struct {
+    uint32_t count;         // handler runs, all cores
+    uint32_t max_ns;        // longest handler run
+    uint32_t spurious;      // pending with no handler (source disabled again)
+} irq_stats_t;
+
+/* Mask everything at both controllers and route peripheral IRQs to
+ * core 0. Call once, on core 0, before any irq_enable(). */
+void irq_init(void);
+
+/* Set the handler for irq; replaces any earlier one. Register before
+ * enabling. */
+void irq_register(uint32_t irq, irq_fn fn, void *ctx);
+void irq_enable(uint32_t irq);
+void irq_disable(uint32_t irq);
+
+/* Send every peripheral IRQ to core */
+void irq_route_gpu(uint32_t core);
+
+/* Called from the IRQ vector in start.S */
+void irq_dispatch(void);
+
+/* Per-source counters since boot */
+void irq_get_stats(uint32_t irq, irq_stats_t *out);
+
+/* IRQs taken on the calling core since boot; a change means a handler
+ * has run in between */
+uint32_t irq_taken(void);
+
+// ------------------------------------------------------------
+// Masking on the calling core
+// ------------------------------------------------------------
+#ifndef HOST_SIM
+/* Unmask IRQs on this core; cores start with them masked */
+static inline void irq_cpu_enable(void) {
+    __asm__ volatile("msr daifclr, #2" ::: "memory");
+}
+
+/* Mask IRQs, returning the previous state for irq_restore() */
+static inline uint64_t irq_save(void) {
+    uint64_t daif;
+    __asm__ volatile("mrs %0, daif\n"
+                     "msr daifset, #2" : "=r"(daif) :: "memory");
+    return daif;
+}
+
+static inline void irq_restore(uint64_t daif) {
+    __asm__ volatile("msr daif, %0" :: "r"(daif) : "memory");
+}
+
+/* Sleep until an IRQ is pending, masked or not. Call with IRQs masked
+ * after checking for work, so none is taken between check and sleep. */
+static inline void irq_wait(void) {
+    __asm__ volatile("dsb sy\n"
+                     "wfi" ::: "memory");
+}
+#else
+// Host simulator: no interrupts, the bench polls the INT latch
+static inline void irq_cpu_enable(void) { }
+static inline uint64_t irq_save(void) { return 0; }
+static inline void irq_restore(uint64_t daif) { }
+static inline void irq_wait(void) { }
+#endif
@@ -2,4 +2,6 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/* Buffers are cache-maintained around the call: align them to 64 bytes
+ * and pad to whole cache lines so no other data shares their lines. */
 bool mbox_call(uint8_t ch, volatile uint32_t *mbox);
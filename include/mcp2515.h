@@ -2,6 +2,20 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+// MCP2515 INT output (active low), GPIO25 on the common Pi CAN HATs
+#define MCP2515_INT_PIN   25
+
+// can_frame_t.id: 11-bit ID, or 29-bit ID with CAN_EFF_FLAG set
+#define CAN_EFF_FLAG      0x80000000u
+#define CAN_SFF_MASK      0x000007FFu
+#define CAN_EFF_MASK      0x1FFFFFFFu
+
+// Frames waiting for a free TX buffer
+#define MCP2515_TXQ_SIZE  32
+
+// Acceptance filter slots in silicon: RXB0 has 2, RXB1 has 4
+#define MCP2515_NUM_FILTERS 6
+
 typedef struct {
     uint32_t id;
     uint8_t dlc;
@@ -20,6 +34,92 @@ typedef enum {
     MCP_BITRATE_1000K
 } mcp_bitrate_t;
 
-bool mcp2515_init(mcp_xtal_t xtal, mcp_bitrate_t br);
+#define MCP_NUM_BITRATES  4
+
+// mcp2515_init() flags
+#define MCP2515_LISTEN_ONLY 0x01  // never drive the bus: no ACKs, error frames or TX
+#define MCP2515_AUTOBAUD    0x02  // find the bitrate in listen-only mode first
+
+typedef struct {
+    uint32_t queued;        // accepted by mcp2515_send()
+    uint32_t sent;          // TXnIF: frame acknowledged on the bus
+    uint32_t arb_lost;      // sent frames that lost arbitration at least once
+    uint32_t errors;        // TXERR seen on a pending buffer
+    uint32_t dropped;       // rejected because the queue was full
+} mcp_tx_stats_t;
+
+// Fault confinement state, from EFLG
+typedef enum {
+    MCP_ERR_ACTIVE,
+    MCP_ERR_PASSIVE,        // TEC or REC >= 128
+    MCP_ERR_BUS_OFF         // TEC > 255: no longer on the bus
+} mcp_err_state_t;
+
+typedef struct {
+    mcp_err_state_t state;
+    uint8_t tec, rec;       // error counters at the last ERRIF
+    uint8_t eflg;
+    // RXnOVR stays set until serviced, however many frames it stands
+    // for, so the two overflow counts are lower bounds on frames lost
+    uint32_t rx0_overflow;  // RX0OVR events: one or more frames lost at RXB0
+    uint32_t rx1_overflow;  // RX1OVR events: one or more frames lost at RXB1
+    uint32_t rx_ring_full;  // frames lost because the RX ring was full
+    uint32_t msg_errors;    // MERRF: errors during TX or RX
+    uint32_t to_passive;    // transitions into each state
+    uint32_t to_bus_off;
+    uint32_t to_active;
+    uint32_t reinits;       // controller re-initialisations after bus-off
+} mcp_err_stats_t;
+
+typedef void (*mcp_rx_done_fn)(const can_frame_t *f, void *ctx);
+
+/* Reset and configure the controller. With MCP2515_AUTOBAUD the bus is
+ * only listened to until a bitrate locks (see mcp2515_poll()); br is the
+ * first candidate tried, and the rate reported until then. */
+bool mcp2515_init(mcp_xtal_t xtal, mcp_bitrate_t br, uint32_t flags);
+/* Bitrate in use, or the last one tried while autobaud is searching */
+mcp_bitrate_t mcp2515_bitrate(void);
+/* False while the autobaud search is running */
+bool mcp2515_bitrate_locked(void);
+/* Queue a frame for transmission in CAN-ID priority order; never blocks.
+ * Returns false if the software queue is full or the controller was set
+ * up with MCP2515_LISTEN_ONLY. Call it on the CAN core (where the INT
+ * service runs): it may load a TX buffer over SPI0. */
 bool mcp2515_send(const can_frame_t *f);
+/* Frames queued or in TX buffers, not yet sent */
+uint32_t mcp2515_tx_pending(void);
+void mcp2515_tx_stats(mcp_tx_stats_t *out);
+
+/* Program masks and filters so only frames with the listed IDs reach the
+ * CPU (as closely as two masks and six filters allow). IDs use the
+ * can_frame_t encoding. n == 0 goes back to receiving everything. */
+bool mcp2515_set_filters(const uint32_t *ids, uint32_t n);
+/* Pop the next frame drained by mcp2515_isr(); never touches SPI */
 bool mcp2515_recv(can_frame_t *f);
+/* The timestamped RX ring mcp2515_isr() fills, for batch consumers
+ * (can_ring_peek / can_ring_consume). Single consumer only. */
+struct can_ring *mcp2515_rx_ring(void);
+
+/* INT falling-edge service: drains the controller into the RX ring
+ * until INT deasserts. Call from the GPIO IRQ handler; frames are
+ * timestamped with the time of entry. */
+void mcp2515_isr(void);
+/* Start a DMA read of RX buffer rxb (0 or 1); done runs with the decoded
+ * frame when the transfer completes. Fails if SPI DMA is busy. */
+bool mcp2515_read_rx_async(uint8_t rxb, mcp_rx_done_fn done, void *ctx);
+/* True when the INT edge latch is set (for callers without the IRQ) */
+bool mcp2515_int_pending(void);
+/* Frames lost because the RX ring was full */
+uint32_t mcp2515_rx_dropped(void);
+
+/* Error counters, states and frame loss */
+void mcp2515_err_stats(mcp_err_stats_t *out);
+/* Received frames known to be lost: both RX overflows plus ring drops.
+ * A lower bound: each RXnOVR event counts as one frame, though more may
+ * arrive before the flag is serviced. The INT service reads CANINTF on
+ * every pass, so that window is one RX burst at most. */
+uint32_t mcp2515_frames_lost(void);
+/* Housekeeping from the main loop: advances the autobaud search, and
+ * re-initialises the controller after bus-off with back-off between
+ * attempts. now is timer_get_counter(). */
+void mcp2515_poll(uint64_t now);
@@ -0,0 +1,143 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Register map and low-level access shared by the mcp2515*.c modules
+
+// MCP2515 registers (subset)
+#define MCP_CANCTRL   0x0F
+#define MCP_CANSTAT   0x0E
+#define MCP_CNF1      0x2A
+#define MCP_CNF2      0x29
+#define MCP_CNF3      0x28
+#define MCP_TXB0CTRL  0x30
+#define MCP_TXB0SIDH  0x31
+#define MCP_TXB0SIDL  0x32
+#define MCP_TXB0DLC   0x35
+#define MCP_TXB0D0    0x36
+#define MCP_TXBCTRL(n) (0x30 + (n) * 0x10)
+#define MCP_RXB0CTRL  0x60
+#define MCP_RXB0SIDH  0x61
+#define MCP_RXB0SIDL  0x62
+#define MCP_RXB0DLC   0x65
+#define MCP_RXB0D0    0x66
+#define MCP_RXB1CTRL  0x70
+#define MCP_CANINTE   0x2B
+#define MCP_CANINTF   0x2C
+#define MCP_TEC       0x1C
+#define MCP_REC       0x1D
+#define MCP_EFLG      0x2D
+
+// Acceptance filters (4 bytes each: SIDH SIDL EID8 EID0)
+#define MCP_RXF0SIDH  0x00
+#define MCP_RXF1SIDH  0x04
+#define MCP_RXF2SIDH  0x08
+#define MCP_RXF3SIDH  0x10
+#define MCP_RXF4SIDH  0x14
+#define MCP_RXF5SIDH  0x18
+#define MCP_RXM0SIDH  0x20
+#define MCP_RXM1SIDH  0x24
+
+// SPI commands
+#define MCP_CMD_RESET      0xC0
+#define MCP_CMD_READ       0x03
+#define MCP_CMD_WRITE      0x02
+#define MCP_CMD_BITMOD     0x05
+#define MCP_CMD_READSTATUS 0xA0
+#define MCP_CMD_RTS_TXB0   0x81
+#define MCP_CMD_RTS(n)     (0x80 | (1 << (n)))
+#define MCP_CMD_LOAD_TX(n) (0x40 | ((n) << 1))   // LOAD TX BUFFER from TXBnSIDH
+#define MCP_CMD_READ_RXB0  0x90   // READ RX BUFFER from RXB0SIDH
+#define MCP_CMD_READ_RXB1  0x94   // READ RX BUFFER from RXB1SIDH
+
+// MCP2515 SPI clock limit
+#define MCP_SPI_HZ         10000000
+
+// READ RX BUFFER burst: command + SIDH SIDL EID8 EID0 DLC + 8 data bytes
+#define MCP_RX_BURST       14
+
+// CANCTRL REQOP / CANSTAT OPMOD
+#define MCP_MODE_MASK      0xE0
+#define MCP_MODE_NORMAL    0x00
+#define MCP_MODE_LISTEN    0x60
+#define MCP_MODE_CONFIG    0x80
+
+// RXBnCTRL bits
+#define MCP_RXM_ANY        0x60   // receive any message
+#define MCP_RXM_FILTER     0x00   // receive frames matching the filters
+#define MCP_RXB0_BUKT      0x04   // roll RXB0 over into RXB1 when full
+
+// READ STATUS bits
+#define MCP_STAT_RX0IF     0x01
+#define MCP_STAT_RX1IF     0x02
+#define MCP_STAT_TXIF(n)   (0x08 << ((n) * 2))
+#define MCP_STAT_TXIF_ALL  0xA8
+
+// CANINTE / CANINTF bits
+#define MCP_INT_RX0        0x01
+#define MCP_INT_RX1        0x02
+#define MCP_INT_TX(n)      (0x04 << (n))
+#define MCP_INT_TX_ALL     0x1C
+#define MCP_INT_ERR        0x20
+#define MCP_INT_MERR       0x80
+
+// EFLG bits
+#define MCP_EFLG_EWARN     0x01   // TEC or REC >= 96
+#define MCP_EFLG_RXWAR     0x02
+#define MCP_EFLG_TXWAR     0x04
+#define MCP_EFLG_RXEP      0x08   // REC >= 128: error-passive
+#define MCP_EFLG_TXEP      0x10   // TEC >= 128: error-passive
+#define MCP_EFLG_TXBO      0x20   // TEC > 255: bus-off
+#define MCP_EFLG_RX0OVR    0x40
+#define MCP_EFLG_RX1OVR    0x80
+
+// TXBnCTRL bits
+#define MCP_TXB_TXP_MASK   0x03
+#define MCP_TXB_TXREQ      0x08
+#define MCP_TXB_TXERR      0x10
+#define MCP_TXB_MLOA       0x20
+
+// SIDL bits
+#define MCP_SIDL_IDE       0x08   // extended frame (EXIDE in filters)
+
+void mcp_write_reg(uint8_t addr, uint8_t val);
+void mcp_write_regs(uint8_t addr, const uint8_t *vals, uint8_t n);
+uint8_t mcp_read_reg(uint8_t addr);
+void mcp_bit_modify(uint8_t addr, uint8_t mask, uint8_t data);
+/* SIDH SIDL EID8 EID0 for an ID (CAN_EFF_FLAG selects 29-bit) */
+void mcp_encode_id(uint32_t id, uint8_t *out);
+/* Request an operating mode and wait (bounded) for CANSTAT to confirm */
+bool mcp_set_mode(uint8_t mode);
+
+// Transmit side (mcp2515_tx.c), called from the INT service
+void mcp_tx_init(void);
+/* Service the TXnIF completions in a CANINTF value, clearing them */
+void mcp_tx_service(uint8_t intf);
+void mcp_tx_error_service(void);
+/* Requeue the frames that were in TX buffers when the chip was re-init */
+void mcp_tx_restart(void);
+
+/* Reprogram the last mcp2515_set_filters() list (mcp2515_filter.c) */
+bool mcp_filter_restore(void);
+
+// Error management (mcp2515_err.c)
+void mcp_err_init(void);
+/* Service ERRIF/MERRF from a CANINTF value, clearing them */
+void mcp_err_service(uint8_t intf);
+
+/* Reset and reconfigure the controller with the settings from
+ * mcp2515_init(), keeping the RX ring, TX queue and filters */
+bool mcp_reinit(void);
+
+// Bitrate search (mcp2515_autobaud.c)
+void mcp_autobaud_start(mcp_bitrate_t first);
+/* Advance a running search; false when none is running */
+bool mcp_autobaud_poll(uint64_t now);
+bool mcp_autobaud_running(void);
+/* Switch to a candidate bitrate in listen-only mode with all interrupt
+ * sources masked and the flags cleared */
+bool mcp_try_bitrate(mcp_bitrate_t br);
+/* Adopt a bitrate found by the search and bring the bus up properly */
+bool mcp_bitrate_lock(mcp_bitrate_t br);
+/* Set up with MCP2515_LISTEN_ONLY: nothing may be transmitted */
+bool mcp_listen_only(void);
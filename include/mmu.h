@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Memory types (MAIR_EL1 attribute indices)
+typedef enum {
+    MMU_NORMAL    = 0,  // write-back cacheable RAM
+    MMU_DEVICE    = 1,  // Device-nGnRE, peripherals
+    MMU_NORMAL_NC = 2   // normal non-cacheable, write-combining (framebuffer)
+} mmu_mem_t;
+
+/* Build identity-mapped tables and enable the MMU and caches on this core */
+void mmu_init(void);
+/* Enable the MMU with the tables built by mmu_init (secondary cores) */
+void mmu_enable(void);
+/* Change the memory type of [base, base + size), in 2 MB blocks. The blocks
+ * are unmapped for a moment, so nothing else may touch them meanwhile */
+void mmu_map_region(uintptr_t base, size_t size, mmu_mem_t type);
+
+// Data cache maintenance by virtual address, for buffers shared with the
+// GPU or DMA engines. Ranges are widened to whole cache lines, so such a
+// buffer should fill its lines: sized and aligned to CACHE_LINE.
+#define CACHE_LINE      64
+void dcache_clean_range(const volatile void *addr, size_t size);
+void dcache_invalidate_range(const volatile void *addr, size_t size);
+void dcache_clean_invalidate_range(const volatile void *addr, size_t size);
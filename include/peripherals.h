@@ -12,9 +12,8 @@
 // System Timer
 #define TIMER_BASE         (PERIPH_BASE + 0x003000)
 
-// Interrupt Controller (GIC-400)
-#define GIC_DIST_BASE      (PERIPH_BASE + 0x00B000)
-#define GIC_CPU_BASE       (PERIPH_BASE + 0x00C000)
+// Legacy interrupt controller (irq.h)
+#define IRQ_BASE           (PERIPH_BASE + 0x00B200)
 
 // Mailbox
 #define MBOX_BASE          (PERIPH_BASE + 0x00B880)
@@ -24,7 +23,14 @@
 
 #define SPI0_BASE        (PERIPH_BASE + 0x204000)
 
+// DMA controller (channels 0-14)
+#define DMA_BASE           (PERIPH_BASE + 0x007000)
+
+// ARM-local peripherals (core timers, local interrupts, mailboxes)
+#define LOCAL_PERIPH_BASE  0x40000000UL
+
 // MMIO helpers
+#ifndef HOST_SIM
 static inline void mmio_write(uintptr_t addr, uint32_t val) {
     *(volatile uint32_t *)addr = val;
 }
@@ -33,3 +39,42 @@ static inline uint32_t mmio_read(uintptr_t addr) {
     return *(volatile uint32_t *)addr;
 }
 
+// Ordered variants, for handing memory to a device or reading what it
+// left there. The write waits for earlier stores (DMA control blocks,
+// mailbox buffers, data announced by a doorbell) to complete first; the
+// read completes before any later load.
+static inline void mmio_write_ordered(uintptr_t addr, uint32_t val) {
+    __asm__ volatile("dsb st" ::: "memory");
+    *(volatile uint32_t *)addr = val;
+}
+
+static inline uint32_t mmio_read_ordered(uintptr_t addr) {
+    uint32_t val = *(volatile uint32_t *)addr;
+    __asm__ volatile("dsb ld" ::: "memory");
+    return val;
+}
+#else
+// Host simulator: register accesses go to the simulated devices, see
+// host/sim_dma.c. Only the programs that link one may touch registers.
+uint32_t sim_mmio_read(uintptr_t addr);
+void sim_mmio_write(uintptr_t addr, uint32_t val);
+
+static inline void mmio_write(uintptr_t addr, uint32_t val) {
+    sim_mmio_write(addr, val);
+}
+
+static inline uint32_t mmio_read(uintptr_t addr) {
+    return sim_mmio_read(addr);
+}
+
+static inline void mmio_write_ordered(uintptr_t addr, uint32_t val) {
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    sim_mmio_write(addr, val);
+}
+
+static inline uint32_t mmio_read_ordered(uintptr_t addr) {
+    uint32_t val = sim_mmio_read(addr);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return val;
+}
+#endif
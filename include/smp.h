@@ -0,0 +1,27 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Secondary core bring-up.
+ *
+ * The firmware parks cores 1-3 in its spin table; smp_start_core()
+ * releases one into a C entry point. start.S gives it its own 16 KB
+ * stack, drops it to EL1, installs the vector table and enables the MMU
+ * with core 0's page tables before the entry runs.
+ */
+
+#define SMP_NUM_CORES   4
+
+typedef void (*smp_entry_fn)(void *ctx);
+
+/* Core number of the caller, 0-3 (MPIDR_EL1.Aff0) */
+uint32_t smp_core_id(void);
+
+/* Run fn(ctx) on core 1-3; fn should not return. Call from core 0 after
+ * mmu_init(). False if the core is already running or did not check in
+ * within 100 ms. */
+bool smp_start_core(uint32_t core, smp_entry_fn fn, void *ctx);
+
+/* Called by start.S on a released core; runs its entry */
+void smp_secondary_main(uint32_t core);
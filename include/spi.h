@@ -1,7 +1,32 @@
 #pragma once
 #include <stdint.h>
+#include <stdbool.h>
+
+// SPI0 runs from the 250 MHz core clock
+#define SPI_CORE_CLK_HZ  250000000u
+// Depth of the SPI0 TX/RX FIFOs, in bytes
+#define SPI_FIFO_DEPTH   16
+
+// Largest DMA transaction, in bytes (a multiple of 4)
+#define SPI_DMA_MAX      32
+
+typedef void (*spi_done_fn)(const uint8_t *rx, uint32_t len, void *ctx);
 
 void spi_init(void);
+/* Fastest even divider that does not exceed hz; 0 selects the slowest */
+void spi_set_clock_hz(uint32_t hz);
+
+/* Full-duplex transaction with chip select held for all len bytes.
+ * tx may be NULL to clock out zeros, rx may be NULL to discard. */
+void spi_xfer(const uint8_t *tx, uint8_t *rx, uint32_t len);
+
+/* Manual transactions: spi_cs_low(), any number of spi_transfer(), spi_cs_high() */
 uint8_t spi_transfer(uint8_t v);
 void spi_cs_low(void);
 void spi_cs_high(void);
+
+/* DMA transaction paced by the SPI DREQs: returns at once, done runs from
+ * the RX channel's completion with the received bytes. Lengths are padded
+ * to whole words. Fails if another DMA transaction is in flight. */
+bool spi_xfer_async(const uint8_t *tx, uint32_t len, spi_done_fn done, void *ctx);
+bool spi_busy(void);
@@ -0,0 +1,155 @@
+#pragma once
+#include "irq.h"
+#include <stdint.h>
+#include <stdbool.h>
+#ifdef HOST_SIM
+#include <sched.h>
+#endif
+
+/*
+ * Inter-core synchronisation: atomics, barriers and ticket spinlocks.
+ *
+ * The atomics are the compiler's __atomic builtins (the C11 memory
+ * model): LDAR/STLR and exclusive-pair loops on AArch64, ordered against
+ * the other cores in the inner-shareable domain. The spinlock is
+ * hand-written LDAXR/STXR on the target and plain builtins with
+ * HOST_SIM, so the same callers build and can be stress-tested on Linux
+ * threads (host/lockbench).
+ *
+ * Exclusives need the MMU and caches on: on device memory they fault.
+ */
+
+// ------------------------------------------------------------
+// Atomics
+// ------------------------------------------------------------
+#define sync_load_acq(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define sync_load_rlx(p)        __atomic_load_n((p), __ATOMIC_RELAXED)
+#define sync_store_rel(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define sync_store_rlx(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define sync_fetch_add(p, v)    __atomic_fetch_add((p), (v), __ATOMIC_ACQ_REL)
+#define sync_fetch_or(p, v)     __atomic_fetch_or((p), (v), __ATOMIC_ACQ_REL)
+#define sync_fetch_and(p, v)    __atomic_fetch_and((p), (v), __ATOMIC_ACQ_REL)
+#define sync_xchg(p, v)         __atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
+/* Store v if *p equals *expp, else load *p into *expp; true on store */
+#define sync_cas(p, expp, v)    __atomic_compare_exchange_n((p), (expp), (v), false, \
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+// ------------------------------------------------------------
+// Barriers and events
+// ------------------------------------------------------------
+#ifndef HOST_SIM
+/* Order memory accesses between cores */
+#define sync_dmb()      __asm__ volatile("dmb ish" ::: "memory")
+/* Wait for earlier stores to complete, e.g. before a device or the GPU
+ * reads what they wrote through non-cacheable memory */
+#define sync_dsb_st()   __asm__ volatile("dsb st" ::: "memory")
+/* Wake every core sleeping in sync_wfe() */
+#define sync_sev()      __asm__ volatile("sev" ::: "memory")
+/* Sleep until an event, an interrupt or a lost exclusive monitor */
+#define sync_wfe()      __asm__ volatile("wfe" ::: "memory")
+#else
+#define sync_dmb()      __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define sync_dsb_st()   __atomic_thread_fence(__ATOMIC_RELEASE)
+#define sync_sev()      ((void)0)
+#define sync_wfe()      sched_yield()
+#endif
+
+// ------------------------------------------------------------
+// Ticket spinlock
+//
+// Cores are served in the order they asked, so a busy lock cannot
+// starve one of them. Waiters sleep in WFE with the exclusive monitor
+// armed on the owner field: the unlock's store clears it, which wakes
+// them without a SEV. For short critical sections only.
+// ------------------------------------------------------------
+typedef union {
+    uint32_t val;
+    struct {
+        uint16_t owner;     // ticket being served
+        uint16_t next;      // next ticket to hand out
+    };
+} spinlock_t;
+
+#ifndef HOST_SIM
+static inline void spin_lock(spinlock_t *l) {
+    uint32_t val, tmp, status;
+
+    __asm__ volatile(
+        "   prfm    pstl1strm, %3\n"
+        "1: ldaxr   %w0, %3\n"
+        "   add     %w1, %w0, #0x10000\n"       // take ticket: next++
+        "   stxr    %w2, %w1, %3\n"
+        "   cbnz    %w2, 1b\n"
+        "   eor     %w1, %w0, %w0, ror #16\n"   // owner == our ticket?
+        "   cbz     %w1, 3f\n"
+        "   sevl\n"
+        "2: wfe\n"
+        "   ldaxrh  %w2, %4\n"
+        "   eor     %w1, %w2, %w0, lsr #16\n"
+        "   cbnz    %w1, 2b\n"
+        "3:\n"
+        : "=&r"(val), "=&r"(tmp), "=&r"(status), "+Q"(l->val)
+        : "Q"(l->owner)
+        : "memory");
+}
+
+static inline bool spin_trylock(spinlock_t *l) {
+    uint32_t val, busy;
+
+    __asm__ volatile(
+        "1: ldaxr   %w0, %2\n"
+        "   eor     %w1, %w0, %w0, ror #16\n"
+        "   cbnz    %w1, 2f\n"                  // held: leave without a ticket
+        "   add     %w0, %w0, #0x10000\n"
+        "   stxr    %w1, %w0, %2\n"
+        "   cbnz    %w1, 1b\n"
+        "2:\n"
+        : "=&r"(val), "=&r"(busy), "+Q"(l->val)
+        :: "memory");
+    return busy == 0;
+}
+
+static inline void spin_unlock(spinlock_t *l) {
+    uint32_t tmp;
+
+    // Only the holder writes owner, so the increment needs no exclusives
+    __asm__ volatile(
+        "   ldrh    %w1, %0\n"
+        "   add     %w1, %w1, #1\n"
+        "   stlrh   %w1, %0\n"
+        : "+Q"(l->owner), "=&r"(tmp)
+        :: "memory");
+}
+#else
+static inline void spin_lock(spinlock_t *l) {
+    uint16_t ticket = __atomic_fetch_add(&l->next, 1, __ATOMIC_RELAXED);
+
+    while (__atomic_load_n(&l->owner, __ATOMIC_ACQUIRE) != ticket)
+        sync_wfe();
+}
+
+static inline bool spin_trylock(spinlock_t *l) {
+    uint32_t val = __atomic_load_n(&l->val, __ATOMIC_RELAXED);
+
+    if ((val & 0xFFFF) != (val >> 16))
+        return false;
+    return __atomic_compare_exchange_n(&l->val, &val, val + 0x10000, false,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static inline void spin_unlock(spinlock_t *l) {
+    __atomic_store_n(&l->owner, (uint16_t)(l->owner + 1), __ATOMIC_RELEASE);
+}
+#endif
+
+/* Also keeps IRQs off on this core, for state shared with a handler */
+static inline uint64_t spin_lock_irqsave(spinlock_t *l) {
+    uint64_t daif = irq_save();
+    spin_lock(l);
+    return daif;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t *l, uint64_t daif) {
+    spin_unlock(l);
+    irq_restore(daif);
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Tickless task loop, one task list per core.
+ *
+ * A task runs when it is due and returns when it next wants to run: an
+ * absolute timer_get_counter() time, or TASK_IDLE to run only when
+ * task_wake() is called. Between passes the core sleeps in WFI with its
+ * core timer armed for the earliest due task, so it wakes for that
+ * task, for any interrupt routed to it, or for a doorbell. There is no
+ * periodic tick: a core with nothing due stays asleep.
+ *
+ * Each core counts the time it spends asleep; tasks_idle_us() shows how
+ * much headroom it has left.
+ */
+
+#define TASK_IDLE   UINT64_MAX
+
+/* Returns the next time to run, or TASK_IDLE. now is timer_get_counter()
+ * at the start of the pass. */
+typedef uint64_t (*task_fn)(uint64_t now, void *ctx);
+
+typedef struct task {
+    task_fn fn;
+    void *ctx;
+    bool on_irq;            // also run after every interrupt taken on its core
+
+    // Owned by tasks.c
+    uint32_t core;
+    uint64_t due;
+    uint32_t woken;
+    struct task *next;
+} task_t;
+
+/* Add t to core's list, due at once. Safe while that core is running. */
+void task_add(task_t *t, uint32_t core);
+
+/* Run t on its next pass, from any core or IRQ handler */
+void task_wake(task_t *t);
+
+/* Run the calling core's tasks, and draw tile bands (fb_tiles.h) while
+ * a job is open; never returns. Unmasks IRQs on the core. */
+void tasks_run(void);
+
+/* Microseconds core has spent asleep since it entered tasks_run() */
+uint64_t tasks_idle_us(uint32_t core, uint64_t now);
@@ -1,6 +1,19 @@
 #pragma once
 #include <stdint.h>
 
+/*
+ * The free-running 1 MHz system timer is the clock: timer_get_counter()
+ * is microseconds since power-on. Each core's EL1 physical timer
+ * (IRQ_CNTPNS) is used only to end a WFI at a given counter value.
+ */
+
+/* Registers the core timer IRQ; call before irq_enable()ing anything */
 void timer_init(void);
+/* Sleeps in WFI for all but the shortest delays. Other IRQs are still
+ * taken if the caller has them unmasked. */
 void timer_delay_us(uint32_t us);
 uint64_t timer_get_counter(void);
+
+/* Make the calling core's next WFI end by timer_get_counter() == us */
+void timer_wake_at(uint64_t us);
+void timer_wake_cancel(void);
@@ -1,6 +1,13 @@
 #pragma once
 #include <stdint.h>
+#include <stdbool.h>
 
 void uart_init(void);
 void uart_putc(char c);
 void uart_puts(const char *s);
+/* Non-blocking read; false when the RX FIFO is empty */
+bool uart_getc(char *c);
+/* RX interrupt (IRQ_UART) on FIFO level or receive timeout. The line
+ * stays up until the FIFO is read, so a handler masks it and the reader
+ * unmasks it again before draining. */
+void uart_rx_irq(bool on);
@@ -0,0 +1,39 @@
+// Generated by tools/dbc2c.py from dbc/dash.dbc -- do not edit
+#include "can_db.h"
+
+const can_signal_t can_db_signals[SIG_COUNT] = {
+    //  shift, len, flags, num, den, offset, min, max
+    [SIG_EEC1_ENGINE_SPEED] = { 48, 16, SIG_BIG_ENDIAN, 250, 1, 0, 0, 8000000 },
+    [SIG_EEC1_ENGINE_LOAD] = { 40, 8, SIG_BIG_ENDIAN, 1000, 1, 0, 0, 100000 },
+    [SIG_EEC1_THROTTLE_POS] = { 32, 8, SIG_BIG_ENDIAN, 400, 1, 0, 0, 100000 },
+    [SIG_ET1_COOLANT_TEMP] = { 0, 8, 0, 1000, 1, -40000, -40000, 210000 },
+    [SIG_ET1_OIL_TEMP] = { 16, 16, 0, 125, 4, -273000, -273000, 1735000 },
+    [SIG_ET1_OIL_PRESSURE] = { 32, 8, 0, 4000, 1, 0, 0, 1000000 },
+    [SIG_WHEEL_SPEEDS_WHEEL_FL] = { 0, 16, 0, 10, 1, 0, 0, 655350 },
+    [SIG_WHEEL_SPEEDS_WHEEL_FR] = { 16, 16, 0, 10, 1, 0, 0, 655350 },
+    [SIG_WHEEL_SPEEDS_WHEEL_RL] = { 32, 16, 0, 10, 1, 0, 0, 655350 },
+    [SIG_WHEEL_SPEEDS_WHEEL_RR] = { 48, 16, 0, 10, 1, 0, 0, 655350 },
+    [SIG_BODY_STATUS_BATTERY_VOLTAGE] = { 0, 12, 0, 10, 1, 0, 0, 40000 },
+    [SIG_BODY_STATUS_BATTERY_CURRENT] = { 36, 12, SIG_BIG_ENDIAN | SIG_SIGNED, 100, 1, 0, -204800, 204700 },
+    [SIG_BODY_STATUS_FUEL_LEVEL] = { 32, 8, 0, 500, 1, 0, 0, 100000 },
+    [SIG_STEERING_ANGLE_ANGLE] = { 48, 16, SIG_BIG_ENDIAN | SIG_SIGNED, 100, 1, 0, -780000, 780000 },
+};
+
+const can_msg_def_t can_db_messages[CAN_DB_NUM_MESSAGES] = {
+    //  id, dlc, first signal, signal count
+    { CAN_MSG_EEC1, 8, SIG_EEC1_ENGINE_SPEED, 3 },
+    { CAN_MSG_ET1, 8, SIG_ET1_COOLANT_TEMP, 3 },
+    { CAN_MSG_WHEEL_SPEEDS, 8, SIG_WHEEL_SPEEDS_WHEEL_FL, 4 },
+    { CAN_MSG_BODY_STATUS, 5, SIG_BODY_STATUS_BATTERY_VOLTAGE, 3 },
+    { CAN_MSG_STEERING_ANGLE, 2, SIG_STEERING_ANGLE_ANGLE, 1 },
+};
+
+const can_db_disp_t can_db_hash_disp[1 << CAN_DB_HASH_BUCKET_BITS] = {
+    0, 1, 0, 0,
+};
+
+const can_db_slot_t can_db_hash[1 << CAN_DB_HASH_BITS] = {
+    1, 3, 0, 2, 4, CAN_DB_HASH_EMPTY, CAN_DB_HASH_EMPTY, CAN_DB_HASH_EMPTY,
+};
+
+int32_t sig_values[SIG_COUNT];
@@ -0,0 +1,32 @@
+#include "can_dispatch.h"
+#include "can_db.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Indexed like can_db_messages[]
+static struct {
+    can_handler_fn fn;
+    void *ctx;
+} handlers[CAN_DB_NUM_MESSAGES];
+
+bool can_dispatch_register(uint32_t id, can_handler_fn fn, void *ctx) {
+    const can_msg_def_t *m = can_db_find(id);
+    if (!m)
+        return false;
+
+    uint32_t n = m - can_db_messages;
+    handlers[n].fn = fn;
+    handlers[n].ctx = ctx;
+    return true;
+}
+
+const can_msg_def_t *can_dispatch(const can_frame_t *f) {
+    const can_msg_def_t *m = can_db_find(f->id);
+    if (!m || !can_decode_msg(m, f))
+        return 0;
+
+    uint32_t n = m - can_db_messages;
+    if (handlers[n].fn)
+        handlers[n].fn(f, m, handlers[n].ctx);
+    return m;
+}
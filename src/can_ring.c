@@ -0,0 +1,71 @@
+#include "can_ring.h"
+#include "sync.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RING_MASK (CAN_RING_SIZE - 1)
+
+// Single producer, single consumer: acquire/release on the indices
+// (LDAR/STLR, sync.h) is all the ordering the slots need
+
+void can_ring_init(can_ring_t *r) {
+    r->head = 0;
+    r->tail = 0;
+    r->dropped = 0;
+    r->high_water = 0;
+}
+
+bool can_ring_push(can_ring_t *r, const can_frame_t *f, uint64_t ts) {
+    uint32_t head = r->head;
+    uint32_t used = head - sync_load_acq(&r->tail);
+
+    if (used >= CAN_RING_SIZE) {
+        sync_store_rel(&r->dropped, r->dropped + 1);
+        return false;
+    }
+
+    can_rx_t *slot = &r->slots[head & RING_MASK];
+    slot->ts = ts;
+    slot->frame = *f;
+
+    if (used + 1 > r->high_water)
+        sync_store_rel(&r->high_water, used + 1);
+
+    sync_store_rel(&r->head, head + 1);     // publish the slot
+    return true;
+}
+
+uint32_t can_ring_peek(can_ring_t *r, const can_rx_t **batch) {
+    uint32_t tail = r->tail;
+    uint32_t avail = sync_load_acq(&r->head) - tail;
+    uint32_t to_wrap = CAN_RING_SIZE - (tail & RING_MASK);
+
+    *batch = &r->slots[tail & RING_MASK];
+    return avail < to_wrap ? avail : to_wrap;
+}
+
+void can_ring_consume(can_ring_t *r, uint32_t n) {
+    sync_store_rel(&r->tail, r->tail + n);  // slots may now be reused
+}
+
+bool can_ring_pop(can_ring_t *r, can_rx_t *out) {
+    const can_rx_t *batch;
+    if (!can_ring_peek(r, &batch))
+        return false;
+
+    *out = *batch;
+    can_ring_consume(r, 1);
+    return true;
+}
+
+uint32_t can_ring_count(const can_ring_t *r) {
+    return sync_load_acq(&r->head) - sync_load_acq(&r->tail);
+}
+
+uint32_t can_ring_dropped(const can_ring_t *r) {
+    return sync_load_rlx(&r->dropped);
+}
+
+uint32_t can_ring_high_water(const can_ring_t *r) {
+    return sync_load_rlx(&r->high_water);
+}
@@ -0,0 +1,65 @@
+#include "can_signals.h"
+#include "can_db.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Perfect hash generated by tools/dbc2c.py: every DB ID lands in its own
+// slot, so a lookup is two multiplies, two table loads and one compare
+const can_msg_def_t *can_db_find(uint32_t id) {
+    uint32_t b = (id * CAN_DB_HASH_MULT1) >> (32 - CAN_DB_HASH_BUCKET_BITS);
+    uint32_t slot = ((id * CAN_DB_HASH_MULT2) >> (32 - CAN_DB_HASH_BITS))
+                  + can_db_hash_disp[b];
+    uint32_t n = can_db_hash[slot & ((1u << CAN_DB_HASH_BITS) - 1)];
+
+    // Unknown IDs hash somewhere too; the ID compare rejects them
+    if (n == CAN_DB_HASH_EMPTY || can_db_messages[n].id != id)
+        return 0;
+    return &can_db_messages[n];
+}
+
+const can_msg_def_t *can_decode(const can_frame_t *f) {
+    const can_msg_def_t *m = can_db_find(f->id);
+    if (!m || !can_decode_msg(m, f))
+        return 0;
+    return m;
+}
+
+bool can_decode_msg(const can_msg_def_t *m, const can_frame_t *f) {
+    if (f->dlc < m->dlc)
+        return false;
+
+    // The payload as two words; every signal is then one shift and mask.
+    // Bytes past the DLC are never part of a signal in the DBC.
+    uint64_t word[2] = { 0, 0 };
+    for (int i = 0; i < 8; i++) {
+        word[0] |= (uint64_t)f->data[i] << (8 * i);         // Intel
+        word[1] = (word[1] << 8) | f->data[i];              // Motorola
+    }
+
+    const can_signal_t *s = &can_db_signals[m->first];
+    int32_t *out = &sig_values[m->first];
+
+    for (uint32_t i = 0; i < m->count; i++, s++) {
+        uint64_t mask = s->len == 64 ? ~0ull : (1ull << s->len) - 1;
+        uint64_t raw = (word[s->flags & SIG_BIG_ENDIAN] >> s->shift) & mask;
+
+        int64_t v;
+        if (s->flags & SIG_SIGNED) {
+            uint64_t sign = 1ull << (s->len - 1);
+            v = (int64_t)((raw ^ sign) - sign);
+        } else {
+            v = (int64_t)raw;
+        }
+
+        v *= s->num;
+        if (s->den != 1)
+            v /= (int64_t)s->den;
+        v += s->offset;
+
+        if (v < s->min) v = s->min;
+        if (v > s->max) v = s->max;
+        out[i] = (int32_t)v;
+    }
+
+    return true;
+}
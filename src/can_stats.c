@@ -0,0 +1,229 @@
+#include "can_stats.h"
+#include "uart.h"
+#include "fmt.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SLOT_MASK  (CAN_STATS_SLOTS - 1)
+#define PERIOD_MAX (UINT32_MAX >> CAN_STATS_EWMA_SHIFT)
+
+// Worst-case stuffed frame length in bits, interframe space included:
+// g + 8n + 13 + (g + 8n - 1) / 4, with g = 34 (11-bit) or 54 (29-bit)
+// control/ID/CRC bits subject to stuffing. An upper bound, so bus load
+// errs high.
+#define FRAME_BITS(g, n) ((g) + 8 * (n) + 13 + ((g) + 8 * (n) - 1) / 4)
+#define BITS_ROW(g) { FRAME_BITS(g, 0), FRAME_BITS(g, 1), FRAME_BITS(g, 2), \
+                      FRAME_BITS(g, 3), FRAME_BITS(g, 4), FRAME_BITS(g, 5), \
+                      FRAME_BITS(g, 6), FRAME_BITS(g, 7), FRAME_BITS(g, 8) }
+static const uint8_t frame_bits[2][9] = { BITS_ROW(34), BITS_ROW(54) };
+
+static can_id_stats_t table[CAN_STATS_SLOTS];
+static uint32_t id_count;
+static uint32_t untracked;
+
+static uint32_t bitrate;
+static uint64_t window_start;
+static uint32_t window_bits;
+static uint32_t window_frames;
+static uint32_t bus_load;               // 0.1% units
+static uint32_t bus_fps;
+
+void can_stats_init(mcp_bitrate_t br) {
+    switch (br) {
+    case MCP_BITRATE_125K:  bitrate = 125000;  break;
+    case MCP_BITRATE_250K:  bitrate = 250000;  break;
+    case MCP_BITRATE_500K:  bitrate = 500000;  break;
+    case MCP_BITRATE_1000K: bitrate = 1000000; break;
+    }
+
+    for (int i = 0; i < CAN_STATS_SLOTS; i++)
+        table[i].count = 0;
+
+    id_count = 0;
+    untracked = 0;
+    window_start = 0;
+    window_bits = 0;
+    window_frames = 0;
+    bus_load = 0;
+    bus_fps = 0;
+}
+
+// Linear probing from a multiplicative hash; NULL only when full
+static can_id_stats_t *lookup(uint32_t id) {
+    uint32_t h = (id * 0x9E3779B1u) >> (32 - CAN_STATS_SLOT_BITS);
+
+    for (uint32_t i = 0; i < CAN_STATS_SLOTS; i++) {
+        can_id_stats_t *s = &table[(h + i) & SLOT_MASK];
+        if (s->count == 0 || s->id == id)
+            return s;
+    }
+    return 0;
+}
+
+void can_stats_record(const can_frame_t *f, uint64_t ts) {
+    uint8_t dlc = f->dlc > 8 ? 8 : f->dlc;
+
+    window_bits += frame_bits[(f->id & CAN_EFF_FLAG) != 0][dlc];
+    window_frames++;
+
+    can_id_stats_t *s = lookup(f->id);
+    if (!s) {
+        untracked++;
+        return;
+    }
+
+    if (s->count == 0) {
+        s->id = f->id;
+        s->count = 1;
+        s->first_ts = ts;
+        s->last_ts = ts;
+        s->min_period = UINT32_MAX;
+        s->max_period = 0;
+        s->avg_q = 0;
+        s->jitter_q = 0;
+        s->dlc = dlc;
+        s->dlc_changes = 0;
+        id_count++;
+        return;
+    }
+
+    // Capped so the shifted EWMAs cannot overflow (~268 s)
+    uint64_t dt = ts - s->last_ts;
+    uint32_t period = dt > PERIOD_MAX ? PERIOD_MAX : (uint32_t)dt;
+
+    if (period < s->min_period) s->min_period = period;
+    if (period > s->max_period) s->max_period = period;
+
+    // The first period seeds the average instead of decaying up from 0
+    if (s->count == 1) {
+        s->avg_q = period << CAN_STATS_EWMA_SHIFT;
+    } else {
+        uint32_t avg = s->avg_q >> CAN_STATS_EWMA_SHIFT;
+        uint32_t dev = period > avg ? period - avg : avg - period;
+        s->avg_q += period - avg;
+        s->jitter_q += dev - (s->jitter_q >> CAN_STATS_EWMA_SHIFT);
+    }
+
+    if (dlc != s->dlc) {
+        s->dlc = dlc;
+        s->dlc_changes++;
+    }
+
+    s->last_ts = ts;
+    s->count++;
+}
+
+void can_stats_tick(uint64_t now) {
+    if (window_start == 0) {
+        window_start = now;
+        return;
+    }
+
+    uint64_t elapsed = now - window_start;
+    if (elapsed < CAN_STATS_WINDOW_US)
+        return;
+
+    // bits * 1e6 / elapsed = bits per second; * 1000 / bitrate = 0.1% units
+    bus_load = (uint32_t)((uint64_t)window_bits * 1000000u / elapsed * 1000u / bitrate);
+    bus_fps = (uint32_t)((uint64_t)window_frames * 1000000u / elapsed);
+
+    window_start = now;
+    window_bits = 0;
+    window_frames = 0;
+}
+
+const can_id_stats_t *can_stats_table(void) {
+    return table;
+}
+
+uint32_t can_stats_ids(void) {
+    return id_count;
+}
+
+uint32_t can_stats_untracked(void) {
+    return untracked;
+}
+
+uint32_t can_stats_mean_period(const can_id_stats_t *s) {
+    if (s->count < 2)
+        return 0;
+    return (uint32_t)((s->last_ts - s->first_ts) / (s->count - 1));
+}
+
+uint32_t can_stats_bus_load(void) {
+    return bus_load;
+}
+
+uint32_t can_stats_bus_fps(void) {
+    return bus_fps;
+}
+
+// ------------------------------------------------------------
+// Text output
+// ------------------------------------------------------------
+
+const char can_stats_header[] =
+    "      id     count   min(us)  mean(us)   max(us)    jitter dlc chg";
+
+int can_stats_fmt_row(char *buf, const can_id_stats_t *s) {
+    int n = 0;
+
+    // IDs right-aligned in 8 columns
+    if (s->id & CAN_EFF_FLAG) {
+        n += fmt_u32_hex(buf + n, s->id & CAN_EFF_MASK, 8);
+    } else {
+        while (n < 5)
+            buf[n++] = ' ';
+        n += fmt_u32_hex(buf + n, s->id, 3);
+    }
+
+    n += fmt_u32_dec_w(buf + n, s->count, 10);
+    n += fmt_u32_dec_w(buf + n, s->count > 1 ? s->min_period : 0, 10);
+    n += fmt_u32_dec_w(buf + n, can_stats_mean_period(s), 10);
+    n += fmt_u32_dec_w(buf + n, s->max_period, 10);
+    n += fmt_u32_dec_w(buf + n, can_stats_jitter(s), 10);
+    n += fmt_u32_dec_w(buf + n, s->dlc, 4);
+    n += fmt_u32_dec_w(buf + n, s->dlc_changes, 4);
+    buf[n] = 0;
+    return n;
+}
+
+// At most 75 characters: a load below 1000% and the counters at full width
+int can_stats_fmt_summary(char *buf) {
+    int n = 0;
+
+    n += fmt_str(buf + n, "bus load ");
+    n += fmt_u32_dec(buf + n, bus_load / 10);
+    buf[n++] = '.';
+    n += fmt_u32_dec(buf + n, bus_load % 10);
+    n += fmt_str(buf + n, "%, ");
+    n += fmt_u32_dec(buf + n, bus_fps);
+    n += fmt_str(buf + n, " frames/s, ");
+    n += fmt_u32_dec(buf + n, id_count);
+    n += fmt_str(buf + n, " IDs");
+    if (untracked) {
+        n += fmt_str(buf + n, ", untracked ");
+        n += fmt_u32_dec(buf + n, untracked);
+    }
+    buf[n] = 0;
+    return n;
+}
+
+void can_stats_dump(void) {
+    char buf[CAN_STATS_LINE_MAX];
+
+    can_stats_fmt_summary(buf);
+    uart_puts(buf);
+    uart_puts("\n");
+    uart_puts(can_stats_header);
+    uart_puts("\n");
+
+    for (int i = 0; i < CAN_STATS_SLOTS; i++) {
+        if (table[i].count == 0)
+            continue;
+
+        can_stats_fmt_row(buf, &table[i]);
+        uart_puts(buf);
+        uart_puts("\n");
+    }
+}
@@ -0,0 +1,218 @@
+#include "compositor.h"
+#include "framebuffer.h"
+#include "fb_dlist.h"
+#include "sync.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+static framebuffer_t *comp_fb;
+static uint32_t comp_bg;
+
+static widget_t *widgets[COMP_MAX_WIDGETS];
+static int widget_count = 0;
+
+// Damage may be added from any core while another flushes: comp_lock
+// covers the list, and the flush paints from a copy taken under it
+static spinlock_t comp_lock;
+static fb_rect_t damage[COMP_MAX_DAMAGE];
+static int damage_count = 0;
+
+// With two pages the back buffer is one frame stale, so each flush also
+// repaints what changed on the previous frame
+static fb_rect_t prev_damage[COMP_MAX_DAMAGE];
+static int prev_count = 0;
+
+static fb_dlist_t comp_dl;
+
+static comp_notify_fn notify_fn;
+static void *notify_ctx;
+
+static inline uint32_t rect_area(const fb_rect_t *r) {
+    return (uint32_t)r->w * (uint32_t)r->h;
+}
+
+void comp_init(framebuffer_t *fb, uint32_t bg) {
+    comp_fb = fb;
+    comp_bg = bg;
+    widget_count = 0;
+    damage_count = 0;
+    prev_count = 0;
+}
+
+bool comp_add_widget(widget_t *w) {
+    if (widget_count >= COMP_MAX_WIDGETS)
+        return false;
+
+    widgets[widget_count++] = w;
+    comp_damage_widget(w);
+    return true;
+}
+
+void comp_show_widget(widget_t *w, bool show) {
+    if (w->hidden == !show)
+        return;
+
+    w->hidden = !show;
+    comp_damage_widget(w);
+}
+
+// ------------------------------------------------------------
+// Damage list
+// ------------------------------------------------------------
+
+static void damage_locked(const fb_rect_t *r) {
+    fb_rect_t screen = { 0, 0, (int32_t)comp_fb->width, (int32_t)comp_fb->height };
+    fb_rect_t d;
+
+    if (!fb_rect_intersect(&screen, r, &d))
+        return;
+
+    // Merge with an existing rect when the union wastes no more
+    // pixels than drawing both separately would
+    for (int i = 0; i < damage_count; i++) {
+        fb_rect_t u;
+        fb_rect_union(&damage[i], &d, &u);
+
+        if (rect_area(&u) <= rect_area(&damage[i]) + rect_area(&d)) {
+            damage[i] = damage[--damage_count];
+            damage_locked(&u);
+            return;
+        }
+    }
+
+    if (damage_count < COMP_MAX_DAMAGE) {
+        damage[damage_count++] = d;
+        return;
+    }
+
+    // List full: fold the new rect into the one it grows the least
+    int best = 0;
+    uint32_t best_cost = 0xFFFFFFFF;
+
+    for (int i = 0; i < damage_count; i++) {
+        fb_rect_t u;
+        fb_rect_union(&damage[i], &d, &u);
+        uint32_t cost = rect_area(&u) - rect_area(&damage[i]);
+        if (cost < best_cost) {
+            best_cost = cost;
+            best = i;
+        }
+    }
+
+    fb_rect_union(&damage[best], &d, &damage[best]);
+}
+
+void comp_on_damage(comp_notify_fn fn, void *ctx) {
+    notify_ctx = ctx;
+    sync_store_rel(&notify_fn, fn);
+}
+
+static void notify(bool was_empty) {
+    comp_notify_fn fn = sync_load_acq(&notify_fn);
+
+    if (was_empty && fn)
+        fn(notify_ctx);
+}
+
+void comp_damage(const fb_rect_t *r) {
+    spin_lock(&comp_lock);
+    bool was_empty = damage_count == 0;
+    damage_locked(r);
+    bool added = damage_count > 0;
+    spin_unlock(&comp_lock);
+
+    notify(was_empty && added);
+}
+
+void comp_damage_widget(const widget_t *w) {
+    comp_damage(&w->bounds);
+}
+
+void comp_damage_all(void) {
+    fb_rect_t screen = { 0, 0, (int32_t)comp_fb->width, (int32_t)comp_fb->height };
+    spin_lock(&comp_lock);
+    bool was_empty = damage_count == 0;
+    damage_count = 0;
+    damage_locked(&screen);
+    spin_unlock(&comp_lock);
+
+    notify(was_empty);
+}
+
+// ------------------------------------------------------------
+// Flush
+// ------------------------------------------------------------
+
+static void repaint(const fb_rect_t *d) {
+    bool covered = false;
+
+    for (int i = 0; i < widget_count; i++) {
+        if (widgets[i]->opaque && !widgets[i]->hidden &&
+            fb_rect_contains(&widgets[i]->bounds, d)) {
+            covered = true;
+            break;
+        }
+    }
+
+    fb_set_clip(comp_fb, d);
+
+    if (!covered)
+        fb_fill_rect(comp_fb, d->x, d->y, d->w, d->h, comp_bg);
+
+    for (int i = 0; i < widget_count; i++) {
+        fb_rect_t clip;
+        if (widgets[i]->hidden)
+            continue;
+        if (fb_rect_intersect(&widgets[i]->bounds, d, &clip)) {
+            fb_set_clip(comp_fb, &clip);
+            widgets[i]->draw(comp_fb, &clip, widgets[i]->ctx);
+        }
+    }
+}
+
+uint32_t comp_flush(void) {
+    uint32_t pixels = 0;
+    fb_rect_t frame[COMP_MAX_DAMAGE], todo[COMP_MAX_DAMAGE];
+    int frame_count, todo_count;
+
+    // Take this frame's damage and leave an empty list for writers on
+    // other cores. A widget changed mid-paint damages itself again after
+    // the change, so the next flush repairs anything torn.
+    spin_lock(&comp_lock);
+    frame_count = damage_count;
+    for (int i = 0; i < damage_count; i++)
+        frame[i] = damage[i];
+
+    if (comp_fb->num_pages > 1) {
+        for (int i = 0; i < prev_count; i++)
+            damage_locked(&prev_damage[i]);
+    }
+
+    todo_count = damage_count;
+    for (int i = 0; i < damage_count; i++)
+        todo[i] = damage[i];
+    damage_count = 0;
+    spin_unlock(&comp_lock);
+
+    if (todo_count == 0)
+        return 0;
+
+    // Widgets draw into the display list; the tile workers rasterize it
+    fb_batch_begin(comp_fb, &comp_dl);
+
+    for (int i = 0; i < todo_count; i++) {
+        repaint(&todo[i]);
+        pixels += rect_area(&todo[i]);
+    }
+
+    fb_batch_end(comp_fb);
+    fb_set_clip(comp_fb, 0);
+
+    fb_swap(comp_fb);
+
+    for (int i = 0; i < frame_count; i++)
+        prev_damage[i] = frame[i];
+    prev_count = frame_count;
+
+    return pixels;
+}
@@ -0,0 +1,80 @@
+#include "console.h"
+#include "uart.h"
+#include <stdbool.h>
+
+static struct {
+    const char *name;
+    console_cmd_fn fn;
+} cmds[CONSOLE_MAX_CMDS];
+static int cmd_count = 0;
+
+static char line[CONSOLE_LINE_MAX];
+static int line_len = 0;
+
+bool console_register(const char *name, console_cmd_fn fn) {
+    if (cmd_count >= CONSOLE_MAX_CMDS)
+        return false;
+
+    cmds[cmd_count].name = name;
+    cmds[cmd_count].fn = fn;
+    cmd_count++;
+    return true;
+}
+
+// Length of the word at s if it equals name, else 0
+static int match_word(const char *s, const char *name) {
+    int i = 0;
+    while (name[i] && s[i] == name[i])
+        i++;
+
+    if (name[i] || (s[i] && s[i] != ' '))
+        return 0;
+    return i;
+}
+
+static void run_line(void) {
+    const char *s = line;
+    while (*s == ' ')
+        s++;
+    if (!*s)
+        return;
+
+    for (int i = 0; i < cmd_count; i++) {
+        int n = match_word(s, cmds[i].name);
+        if (n) {
+            s += n;
+            while (*s == ' ')
+                s++;
+            cmds[i].fn(s);
+            return;
+        }
+    }
+
+    uart_puts("commands:");
+    for (int i = 0; i < cmd_count; i++) {
+        uart_putc(' ');
+        uart_puts(cmds[i].name);
+    }
+    uart_puts("\n");
+}
+
+void console_poll(void) {
+    char c;
+
+    while (uart_getc(&c)) {
+        if (c == '\r' || c == '\n') {
+            uart_puts("\n");
+            line[line_len] = 0;
+            run_line();
+            line_len = 0;
+        } else if (c == 0x08 || c == 0x7F) {        // backspace
+            if (line_len > 0) {
+                line_len--;
+                uart_puts("\b \b");
+            }
+        } else if (line_len < CONSOLE_LINE_MAX - 1) {
+            line[line_len++] = c;
+            uart_putc(c);                           // echo
+        }
+    }
+}
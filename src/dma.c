@@ -0,0 +1,135 @@
+#include "dma.h"
+#include "irq.h"
+#include "mmu.h"
+#include "peripherals.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DMA_CH_BASE(n)      (DMA_BASE + (n) * 0x100)
+#define DMA_CS(n)           (DMA_CH_BASE(n) + 0x00)
+#define DMA_CONBLK_AD(n)    (DMA_CH_BASE(n) + 0x04)
+#define DMA_DEBUG(n)        (DMA_CH_BASE(n) + 0x20)
+#define DMA_INT_STATUS      (DMA_BASE + 0xFE0)
+#define DMA_ENABLE          (DMA_BASE + 0xFF0)
+
+#define DMA_CS_ACTIVE       (1u << 0)
+#define DMA_CS_END          (1u << 1)
+#define DMA_CS_INT          (1u << 2)
+#define DMA_CS_ERROR        (1u << 8)
+#define DMA_CS_PRIORITY(n)  ((uint32_t)(n) << 16)
+#define DMA_CS_PANIC(n)     ((uint32_t)(n) << 20)
+#define DMA_CS_WAIT_WRITES  (1u << 28)
+#define DMA_CS_ABORT        (1u << 30)
+#define DMA_CS_RESET        (1u << 31)
+
+// Bus address aliases: 0x7E peripheral window, 0xC uncached SDRAM
+#define BUS_PERIPH_BASE     0x7E000000u
+#define BUS_SDRAM_UNCACHED  0xC0000000u
+
+typedef struct {
+    dma_done_fn done;
+    void *ctx;
+    volatile bool busy;
+} dma_chan_t;
+
+static dma_chan_t chans[DMA_NUM_CH];
+
+#ifndef HOST_SIM
+uint32_t dma_bus_addr(const volatile void *p) {
+    return BUS_SDRAM_UNCACHED | ((uint32_t)(uintptr_t)p & 0x3FFFFFFF);
+}
+#else
+// Host pointers do not fit in 30 bits: the fake engine (host/sim_dma.c)
+// hands out bus addresses in the same alias and maps them back
+uint32_t sim_dma_bus_addr(const volatile void *p);
+
+uint32_t dma_bus_addr(const volatile void *p) {
+    return sim_dma_bus_addr(p);
+}
+#endif
+
+uint32_t dma_periph_bus_addr(uintptr_t phys) {
+    return BUS_PERIPH_BASE + (uint32_t)(phys - PERIPH_BASE);
+}
+
+void dma_cb_chain(dma_cb_t *cb, const dma_cb_t *next) {
+    cb->nextconbk = next ? dma_bus_addr(next) : 0;
+}
+
+static void dma_irq(uint32_t irq, void *ctx) {
+    dma_irq_handler(irq - IRQ_DMA(0));
+}
+
+void dma_init(void) {
+    uint32_t mask = (1u << DMA_CH_SPI_TX) | (1u << DMA_CH_SPI_RX);
+
+    mmio_write(DMA_ENABLE, mmio_read(DMA_ENABLE) | mask);
+
+    for (uint32_t ch = 0; ch < DMA_NUM_CH; ch++) {
+        if (!(mask & (1u << ch)))
+            continue;
+        mmio_write(DMA_CS(ch), DMA_CS_RESET);
+        while (mmio_read(DMA_CS(ch)) & DMA_CS_RESET) { }
+        chans[ch].busy = false;
+
+        irq_register(IRQ_DMA(ch), dma_irq, 0);
+        irq_enable(IRQ_DMA(ch));
+    }
+}
+
+void dma_start(uint32_t ch, dma_cb_t *cb, uint32_t ncb, dma_done_fn done, void *ctx) {
+    chans[ch].done = done;
+    chans[ch].ctx = ctx;
+    // Without INTEN at the end nothing reports completion, so nothing
+    // would clear the flag again
+    chans[ch].busy = (cb[ncb - 1].ti & DMA_TI_INTEN) != 0;
+
+    dcache_clean_range(cb, ncb * sizeof(dma_cb_t));
+
+    mmio_write(DMA_CS(ch), DMA_CS_END | DMA_CS_INT);   // clear stale flags
+    mmio_write(DMA_CONBLK_AD(ch), dma_bus_addr(cb));
+    mmio_write_ordered(DMA_CS(ch), DMA_CS_ACTIVE | DMA_CS_WAIT_WRITES |
+                                   DMA_CS_PRIORITY(8) | DMA_CS_PANIC(15));
+}
+
+bool dma_busy(uint32_t ch) {
+    return chans[ch].busy;
+}
+
+void dma_abort(uint32_t ch) {
+    mmio_write(DMA_CS(ch), DMA_CS_RESET);
+    while (mmio_read(DMA_CS(ch)) & DMA_CS_RESET) { }
+    chans[ch].busy = false;
+}
+
+void dma_irq_handler(uint32_t ch) {
+    // Ordered: the done callback reads what the channel wrote
+    uint32_t cs = mmio_read_ordered(DMA_CS(ch));
+    if (!(cs & (DMA_CS_INT | DMA_CS_ERROR)))
+        return;
+
+    // Keep ACTIVE: writing it as 0 would pause a chain still running
+    mmio_write(DMA_CS(ch), DMA_CS_INT | DMA_CS_END | (cs & DMA_CS_ACTIVE));
+
+    // An INTEN block in the middle of a chain doesn't end the transfer
+    if ((cs & DMA_CS_ACTIVE) && !(cs & DMA_CS_ERROR))
+        return;
+
+    bool error = (cs & DMA_CS_ERROR) != 0;
+    if (error)
+        mmio_write(DMA_DEBUG(ch), 0x7);     // clear latched error bits
+
+    chans[ch].busy = false;
+    if (chans[ch].done)
+        chans[ch].done(ch, error, chans[ch].ctx);
+}
+
+void dma_poll(void) {
+    uint32_t pending = mmio_read(DMA_INT_STATUS);
+
+    for (uint32_t ch = 0; ch < DMA_NUM_CH; ch++) {
+        if (chans[ch].busy && ((pending & (1u << ch)) ||
+                               (mmio_read(DMA_CS(ch)) & DMA_CS_ERROR)))
+            dma_irq_handler(ch);
+    }
+}
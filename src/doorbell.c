@@ -0,0 +1,37 @@
+#include "doorbell.h"
+#include "peripherals.h"
+#include "smp.h"
+#include "sync.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef HOST_SIM
+// ARM-local mailboxes: core n's mailbox m is set through a write-only
+// register and cleared by writing ones to its read register
+#define LOCAL_MBOX_SET(n, m)     (LOCAL_PERIPH_BASE + 0x80 + 0x10 * (n) + 4 * (m))
+#define LOCAL_MBOX_RDCLR(n, m)   (LOCAL_PERIPH_BASE + 0xC0 + 0x10 * (n) + 4 * (m))
+
+void doorbell_ring(uint32_t core, uint32_t bits) {
+    mmio_write_ordered(LOCAL_MBOX_SET(core, 0), bits);
+    sync_sev();
+}
+
+uint32_t doorbell_take(uint32_t core) {
+    uint32_t bits = mmio_read_ordered(LOCAL_MBOX_RDCLR(core, 0));
+
+    if (bits)
+        mmio_write(LOCAL_MBOX_RDCLR(core, 0), bits);
+    return bits;
+}
+#else
+// Host simulator: a word per thread stands in for the mailbox
+static uint32_t bell[SMP_NUM_CORES];
+
+void doorbell_ring(uint32_t core, uint32_t bits) {
+    sync_fetch_or(&bell[core], bits);
+}
+
+uint32_t doorbell_take(uint32_t core) {
+    return sync_xchg(&bell[core], 0);
+}
+#endif
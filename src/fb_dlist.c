@@ -0,0 +1,119 @@
+#include "fb_dlist.h"
+#include "fb_tiles.h"
+#include "framebuffer.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+void fb_batch_begin(framebuffer_t *fb, fb_dlist_t *dl) {
+    dl->count = 0;
+    dl->text_used = 0;
+    fb->dl = dl;
+}
+
+void fb_batch_end(framebuffer_t *fb) {
+    fb_dl_flush(fb);
+    fb->dl = 0;
+}
+
+void fb_dl_discard(framebuffer_t *fb) {
+    if (!fb->dl)
+        return;
+
+    fb->dl->count = 0;
+    fb->dl->text_used = 0;
+}
+
+// ------------------------------------------------------------
+// Replay
+// ------------------------------------------------------------
+
+// Runs on every tile worker at once: fb is the worker's own copy with
+// no display list attached, so the fb_* calls below draw for real
+static void replay_band(const framebuffer_t *fb, const fb_rect_t *band, void *ctx) {
+    const fb_dlist_t *dl = ctx;
+    framebuffer_t f = *fb;
+
+    for (uint32_t i = 0; i < dl->count; i++) {
+        const fb_cmd_t *c = &dl->cmds[i];
+        const int32_t *a = c->arg;
+
+        if (!fb_rect_intersect(&c->clip, band, &f.clip))
+            continue;
+
+        switch (c->op) {
+        case FB_OP_PIXEL:
+            fb_put_pixel(&f, a[0], a[1], c->color);
+            break;
+        case FB_OP_FILL:
+            fb_fill_rect(&f, a[0], a[1], a[2], a[3], c->color);
+            break;
+        case FB_OP_COPY:
+            fb_copy_rect(&f, a[0], a[1], c->src, a[2], a[3], a[4], a[5]);
+            break;
+        case FB_OP_BLIT_KEYED:
+            fb_blit_keyed(&f, a[0], a[1], c->src, a[2], a[3], a[4], a[5], c->color);
+            break;
+        case FB_OP_CHAR:
+            fb_draw_char(&f, a[0], a[1], (char)a[2], c->color);
+            break;
+        case FB_OP_TEXT:
+            fb_draw_text(&f, a[0], a[1], &dl->text[c->text], c->color);
+            break;
+        case FB_OP_TEXT_BG:
+            fb_draw_text_bg(&f, a[0], a[1], &dl->text[c->text], c->color, c->bg);
+            break;
+        case FB_OP_LINE:
+            fb_draw_line(&f, a[0], a[1], a[2], a[3], c->color);
+            break;
+        case FB_OP_ARC:
+            fb_draw_arc(&f, a[0], a[1], a[2], a[3], a[4], c->color);
+            break;
+        }
+    }
+}
+
+void fb_dl_flush(framebuffer_t *fb) {
+    fb_dlist_t *dl = fb->dl;
+
+    if (!dl || dl->count == 0)
+        return;
+
+    fb_tiles_run(fb, replay_band, dl);
+    dl->count = 0;
+    dl->text_used = 0;
+}
+
+// ------------------------------------------------------------
+// Recording
+// ------------------------------------------------------------
+
+void fb_dl_add(framebuffer_t *fb, fb_cmd_t *cmd, const fb_rect_t *bounds,
+               const char *s) {
+    fb_dlist_t *dl = fb->dl;
+
+    // Draws that cannot touch a pixel are dropped here, and the rest
+    // carry the tightest clip so each band rejects them with one test
+    if (!fb_rect_intersect(bounds, &fb->clip, &cmd->clip))
+        return;
+
+    uint32_t len = 0;
+    if (s) {
+        while (s[len])
+            len++;
+        if (len >= FB_DL_TEXT)
+            len = FB_DL_TEXT - 1;
+    }
+
+    if (dl->count == FB_DL_MAX_CMDS || (s && dl->text_used + len + 1 > FB_DL_TEXT))
+        fb_dl_flush(fb);
+
+    if (s) {
+        cmd->text = dl->text_used;
+        for (uint32_t i = 0; i < len; i++)
+            dl->text[dl->text_used + i] = s[i];
+        dl->text[dl->text_used + len] = 0;
+        dl->text_used += len + 1;
+    }
+
+    dl->cmds[dl->count++] = *cmd;
+}
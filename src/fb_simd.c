@@ -0,0 +1,100 @@
+#include "fb_simd.h"
+#include <stdint.h>
+
+// Scalar loops: the whole span without SIMD, and the head/tail with it
+
+static inline void fill_scalar(uint32_t *dst, uint32_t color, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++)
+        dst[i] = color;
+}
+
+static inline void copy_scalar(uint32_t *dst, const uint32_t *src, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++)
+        dst[i] = src[i];
+}
+
+static inline void blit_keyed_scalar(uint32_t *dst, const uint32_t *src,
+                                     uint32_t key, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        if (src[i] != key)
+            dst[i] = src[i];
+    }
+}
+
+#if defined(FB_SIMD) && defined(__ARM_NEON)
+
+// Pixels needed to bring dst up to a 16-byte boundary (capped at n).
+// Vector stores stay aligned so they never straddle a cache line.
+static inline uint32_t head_len(const uint32_t *dst, uint32_t n) {
+    uint32_t h = (uint32_t)((16 - ((uintptr_t)dst & 15)) & 15) / 4;
+    return h < n ? h : n;
+}
+
+void fb_span_fill(uint32_t *dst, uint32_t color, uint32_t n) {
+    uint32_t h = head_len(dst, n);
+    fill_scalar(dst, color, h);
+    dst += h;
+    n -= h;
+
+    uint32x4_t c = vdupq_n_u32(color);
+    for (; n >= 16; n -= 16, dst += 16) {
+        vst1q_u32(dst, c);
+        vst1q_u32(dst + 4, c);
+        vst1q_u32(dst + 8, c);
+        vst1q_u32(dst + 12, c);
+    }
+    for (; n >= 4; n -= 4, dst += 4)
+        vst1q_u32(dst, c);
+
+    fill_scalar(dst, color, n);
+}
+
+void fb_span_copy(uint32_t *dst, const uint32_t *src, uint32_t n) {
+    uint32_t h = head_len(dst, n);
+    copy_scalar(dst, src, h);
+    dst += h;
+    src += h;
+    n -= h;
+
+    for (; n >= 16; n -= 16, dst += 16, src += 16) {
+        uint32x4x4_t v = vld1q_u32_x4(src);
+        vst1q_u32_x4(dst, v);
+    }
+    for (; n >= 4; n -= 4, dst += 4, src += 4)
+        vst1q_u32(dst, vld1q_u32(src));
+
+    copy_scalar(dst, src, n);
+}
+
+void fb_span_blit_keyed(uint32_t *dst, const uint32_t *src, uint32_t key, uint32_t n) {
+    uint32_t h = head_len(dst, n);
+    blit_keyed_scalar(dst, src, key, h);
+    dst += h;
+    src += h;
+    n -= h;
+
+    uint32x4_t k = vdupq_n_u32(key);
+    for (; n >= 4; n -= 4, dst += 4, src += 4) {
+        uint32x4_t s = vld1q_u32(src);
+        uint32x4_t is_key = vceqq_u32(s, k);
+        vst1q_u32(dst, vbslq_u32(is_key, vld1q_u32(dst), s));
+    }
+
+    blit_keyed_scalar(dst, src, key, n);
+}
+
+#else
+
+void fb_span_fill(uint32_t *dst, uint32_t color, uint32_t n) {
+    fill_scalar(dst, color, n);
+}
+
+void fb_span_copy(uint32_t *dst, const uint32_t *src, uint32_t n) {
+    copy_scalar(dst, src, n);
+}
+
+void fb_span_blit_keyed(uint32_t *dst, const uint32_t *src, uint32_t key, uint32_t n) {
+    blit_keyed_scalar(dst, src, key, n);
+}
+
+#endif
@@ -0,0 +1,79 @@
+#include "fb_tiles.h"
+#include "framebuffer.h"
+#include "doorbell.h"
+#include "smp.h"
+#include "sync.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// The running job. fb_tiles_run() closes the old job (nbands = 0),
+// rewrites the fields, resets next and publishes nbands, each with
+// release ordering, so a helper that sees the new nbands, or claims a
+// band through next, also sees the fields. A helper whose claim raced
+// with the switch finds its band outside the job and drops it.
+static struct {
+    framebuffer_t fb;
+    fb_band_fn fn;
+    void *ctx;
+    uint32_t nbands;        // 0 while no job is open
+    uint32_t next;          // next band to hand out
+    uint32_t done;          // bands finished
+} job;
+
+static void draw_band(uint32_t b) {
+    fb_rect_t band = {
+        0, (int32_t)(b * FB_TILE_ROWS), (int32_t)job.fb.width, FB_TILE_ROWS
+    };
+    if (band.y + band.h > (int32_t)job.fb.height)
+        band.h = (int32_t)job.fb.height - band.y;
+
+    job.fn(&job.fb, &band, job.ctx);
+
+    // The framebuffer is non-cacheable: drain this core's writes before
+    // the band counts as done and the page goes to the GPU
+    sync_dsb_st();
+
+    sync_fetch_add(&job.done, 1);
+}
+
+bool fb_tiles_help(void) {
+    uint32_t b;
+
+    do {
+        uint32_t n = sync_load_acq(&job.nbands);
+        b = sync_load_rlx(&job.next);
+        if (b >= n)
+            return false;
+    } while (!sync_cas(&job.next, &b, b + 1));
+
+    if (b >= sync_load_acq(&job.nbands))
+        return false;
+
+    draw_band(b);
+    return true;
+}
+
+void fb_tiles_run(const framebuffer_t *fb, fb_band_fn fn, void *ctx) {
+    uint32_t nbands = (fb->height + FB_TILE_ROWS - 1) / FB_TILE_ROWS;
+
+    sync_store_rel(&job.nbands, 0);
+
+    job.fb = *fb;
+    job.fb.dl = 0;
+    job.fn = fn;
+    job.ctx = ctx;
+    sync_store_rlx(&job.done, 0);
+    sync_store_rel(&job.next, 0);
+    sync_store_rel(&job.nbands, nbands);
+
+    // Wake the helpers asleep between tasks (tasks.h). The caller's own
+    // bell too: one spare IRQ is cheaper than telling the cores apart.
+    for (uint32_t core = 0; core < SMP_NUM_CORES; core++)
+        doorbell_ring(core, DOORBELL_WAKE);
+
+    // Draw alongside the helpers until every band is finished
+    while (sync_load_acq(&job.done) < nbands)
+        fb_tiles_help();
+
+    sync_store_rel(&job.nbands, 0);
+}
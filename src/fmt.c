@@ -0,0 +1,78 @@
+#include "fmt.h"
+#include <stdint.h>
+
+int fmt_u32_dec(char *buf, uint32_t v) {
+    char tmp[10];
+    int i = 0;
+
+    if (v == 0) {
+        buf[0] = '0';
+        return 1;
+    }
+
+    while (v > 0) {
+        tmp[i++] = '0' + (v % 10);
+        v /= 10;
+    }
+
+    for (int j = 0; j < i; j++)
+        buf[j] = tmp[i - j - 1];
+
+    return i;
+}
+
+int fmt_u32_dec_w(char *buf, uint32_t v, int width) {
+    char tmp[10];
+    int n = fmt_u32_dec(tmp, v);
+    int pad = width > n ? width - n : 0;
+
+    for (int i = 0; i < pad; i++)
+        buf[i] = ' ';
+    for (int i = 0; i < n; i++)
+        buf[pad + i] = tmp[i];
+
+    return pad + n;
+}
+
+int fmt_u32_dec_z(char *buf, uint32_t v, int width) {
+    char tmp[10];
+    int n = fmt_u32_dec(tmp, v);
+    int pad = width > n ? width - n : 0;
+
+    for (int i = 0; i < pad; i++)
+        buf[i] = '0';
+    for (int i = 0; i < n; i++)
+        buf[pad + i] = tmp[i];
+
+    return pad + n;
+}
+
+int fmt_u32_hex(char *buf, uint32_t v, int width) {
+    static const char hex[] = "0123456789ABCDEF";
+    char tmp[8];
+    int i = 0;
+
+    do {
+        tmp[i++] = hex[v & 0xF];
+        v >>= 4;
+    } while (v && i < 8);
+
+    while (i < width)
+        tmp[i++] = '0';
+
+    for (int j = 0; j < i; j++)
+        buf[j] = tmp[i - j - 1];
+
+    return i;
+}
+
+int fmt_str(char *buf, const char *s) {
+    int n = 0;
+
+    while (s[n]) {
+        buf[n] = s[n];
+        n++;
+    }
+
+    return n;
+}
@@ -2,6 +2,10 @@
 #include "mailbox.h"
 #include "peripherals.h"
 #include "font8x12.h"
+#include "fb_simd.h"
+#include "fb_dlist.h"
+#include "fb_tiles.h"
+#include "mmu.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -52,7 +56,7 @@ static inline int iabs(int v) {
 }
 
 
-static volatile uint32_t mbox[36] __attribute__((aligned(16)));
+static volatile uint32_t mbox[48] __attribute__((aligned(64)));
 
 
 bool fb_init(framebuffer_t *fb, uint32_t w, uint32_t h, uint32_t depth) {
@@ -65,11 +69,12 @@ bool fb_init(framebuffer_t *fb, uint32_t w, uint32_t h, uint32_t depth) {
     mbox[5] = w;
     mbox[6] = h;
 
+    // Virtual screen twice as tall: the two halves are the flip pages
     mbox[7] = 0x00048004;
     mbox[8] = 8;
     mbox[9] = 8;
     mbox[10] = w;
-    mbox[11] = h;
+    mbox[11] = h * 2;
 
     mbox[12] = 0x00048005;
     mbox[13] = 4;
@@ -102,26 +107,170 @@ bool fb_init(framebuffer_t *fb, uint32_t w, uint32_t h, uint32_t depth) {
 
     uint32_t fb_addr = mbox[23] & 0x3FFFFFFF;
 
-    fb->buf    = (volatile uint8_t *)(uintptr_t)fb_addr;
     fb->width  = w;
     fb->height = h;
     fb->pitch  = mbox[28];
     fb->is_rgb = 1;
 
+    fb->pages[0] = (volatile uint8_t *)(uintptr_t)fb_addr;
+    fb->pages[1] = fb->pages[0] + h * fb->pitch;
+
+    // The firmware reports the virtual height it actually granted
+    if (mbox[11] >= h * 2 && mbox[24] >= 2 * h * fb->pitch) {
+        fb->num_pages = 2;
+        fb->back = 1;   // page 0 is on screen after init
+    } else {
+        fb->num_pages = 1;
+        fb->back = 0;
+    }
+
+    fb->buf = fb->pages[fb->back];
+    fb->dl = 0;
+    fb_set_clip(fb, 0);
+
+    // Pixels are write-only streams for the CPU: map them non-cacheable so
+    // stores merge in the write buffer and the GPU sees them without flushes
+    mmu_map_region(fb_addr, mbox[24], MMU_NORMAL_NC);
+
     return true;
 }
 
-void fb_clear(framebuffer_t *fb, uint32_t color) {
-    for (uint32_t y = 0; y < fb->height; y++) {
+void fb_init_surface(framebuffer_t *fb, uint32_t *mem, uint32_t w, uint32_t h) {
+    fb->width     = w;
+    fb->height    = h;
+    fb->pitch     = w * 4;
+    fb->is_rgb    = 1;
+    fb->pages[0]  = (volatile uint8_t *)mem;
+    fb->pages[1]  = fb->pages[0];
+    fb->num_pages = 1;
+    fb->back      = 0;
+    fb->buf       = fb->pages[0];
+    fb->dl        = 0;
+    fb_set_clip(fb, 0);
+}
+
+// ------------------------------------------------------------
+// Page flipping
+// ------------------------------------------------------------
+static volatile uint32_t flip_mbox[16] __attribute__((aligned(64)));
+
+void fb_swap(framebuffer_t *fb) {
+    // Anything still batched belongs to the page going on screen
+    fb_dl_flush(fb);
+
+    if (fb->num_pages < 2)
+        return;
+
+    flip_mbox[0] = 12 * 4;
+    flip_mbox[1] = 0;
+
+    // Set virtual offset: show the page we just finished
+    flip_mbox[2] = 0x00048009;
+    flip_mbox[3] = 8;
+    flip_mbox[4] = 8;
+    flip_mbox[5] = 0;
+    flip_mbox[6] = fb->back * fb->height;
+
+    // Wait for vsync so the old front page is no longer being scanned
+    flip_mbox[7] = 0x0004800E;
+    flip_mbox[8] = 4;
+    flip_mbox[9] = 4;
+    flip_mbox[10] = 0;
+
+    flip_mbox[11] = 0;
+
+    if (!mbox_call(8, flip_mbox))
+        return;     // offset not applied: keep drawing into the same page
+
+    fb->back ^= 1;
+    fb->buf = fb->pages[fb->back];
+}
+
+// ------------------------------------------------------------
+// Clipping
+// ------------------------------------------------------------
+bool fb_rect_intersect(const fb_rect_t *a, const fb_rect_t *b, fb_rect_t *out) {
+    int32_t x0 = a->x > b->x ? a->x : b->x;
+    int32_t y0 = a->y > b->y ? a->y : b->y;
+    int32_t x1 = (a->x + a->w) < (b->x + b->w) ? (a->x + a->w) : (b->x + b->w);
+    int32_t y1 = (a->y + a->h) < (b->y + b->h) ? (a->y + a->h) : (b->y + b->h);
+
+    if (x1 <= x0 || y1 <= y0)
+        return false;
+
+    out->x = x0;
+    out->y = y0;
+    out->w = x1 - x0;
+    out->h = y1 - y0;
+    return true;
+}
+
+void fb_rect_union(const fb_rect_t *a, const fb_rect_t *b, fb_rect_t *out) {
+    int32_t x0 = a->x < b->x ? a->x : b->x;
+    int32_t y0 = a->y < b->y ? a->y : b->y;
+    int32_t x1 = (a->x + a->w) > (b->x + b->w) ? (a->x + a->w) : (b->x + b->w);
+    int32_t y1 = (a->y + a->h) > (b->y + b->h) ? (a->y + a->h) : (b->y + b->h);
+
+    out->x = x0;
+    out->y = y0;
+    out->w = x1 - x0;
+    out->h = y1 - y0;
+}
+
+bool fb_rect_contains(const fb_rect_t *outer, const fb_rect_t *inner) {
+    return inner->x >= outer->x && inner->y >= outer->y &&
+           inner->x + inner->w <= outer->x + outer->w &&
+           inner->y + inner->h <= outer->y + outer->h;
+}
+
+void fb_set_clip(framebuffer_t *fb, const fb_rect_t *r) {
+    fb_rect_t screen = { 0, 0, (int32_t)fb->width, (int32_t)fb->height };
+
+    if (!r) {
+        fb->clip = screen;
+        return;
+    }
+
+    if (!fb_rect_intersect(&screen, r, &fb->clip)) {
+        fb->clip.x = 0;
+        fb->clip.y = 0;
+        fb->clip.w = 0;
+        fb->clip.h = 0;
+    }
+}
+
+static void clear_band(const framebuffer_t *fb, const fb_rect_t *band, void *ctx) {
+    uint32_t color = *(const uint32_t *)ctx;
+
+    for (int32_t y = band->y; y < band->y + band->h; y++) {
         uint32_t *row = (uint32_t *)(fb->buf + y * fb->pitch);
-        for (uint32_t x = 0; x < fb->width; x++) {
-            row[x] = color;
-        }
+        fb_span_fill(row, color, fb->width);
+    }
+}
+
+void fb_clear(framebuffer_t *fb, uint32_t color) {
+    // Batched draws would be painted over anyway
+    fb_dl_discard(fb);
+
+    // Clear every page so both halves start out identical
+    for (uint32_t p = 0; p < fb->num_pages; p++) {
+        framebuffer_t page = *fb;
+        page.buf = fb->pages[p];
+        fb_tiles_run(&page, clear_band, &color);
     }
 }
 
 void fb_put_pixel(framebuffer_t *fb, uint32_t x, uint32_t y, uint32_t color) {
-    if (x >= fb->width || y >= fb->height)
+    if (fb->dl) {
+        fb_cmd_t c = { .op = FB_OP_PIXEL, .arg = { (int32_t)x, (int32_t)y }, .color = color };
+        fb_rect_t b = { (int32_t)x, (int32_t)y, 1, 1 };
+        fb_dl_add(fb, &c, &b, 0);
+        return;
+    }
+
+    // Unsigned subtraction folds the < and >= checks into one compare
+    if (x - (uint32_t)fb->clip.x >= (uint32_t)fb->clip.w ||
+        y - (uint32_t)fb->clip.y >= (uint32_t)fb->clip.h)
         return;
 
     uint32_t *row = (uint32_t *)(fb->buf + y * fb->pitch);
@@ -130,20 +279,90 @@ void fb_put_pixel(framebuffer_t *fb, uint32_t x, uint32_t y, uint32_t color) {
 
 void fb_fill_rect(framebuffer_t *fb, uint32_t x, uint32_t y,
                   uint32_t w, uint32_t h, uint32_t color) {
-    if (x >= fb->width || y >= fb->height)
+    fb_rect_t r = { (int32_t)x, (int32_t)y, (int32_t)w, (int32_t)h };
+
+    if (fb->dl) {
+        fb_cmd_t c = { .op = FB_OP_FILL, .arg = { r.x, r.y, r.w, r.h }, .color = color };
+        fb_dl_add(fb, &c, &r, 0);
         return;
+    }
 
-    if (x + w > fb->width)
-        w = fb->width - x;
+    if (!fb_rect_intersect(&r, &fb->clip, &r))
+        return;
 
-    if (y + h > fb->height)
-        h = fb->height - y;
+    x = r.x;
+    y = r.y;
+    w = r.w;
+    h = r.h;
 
     for (uint32_t yy = 0; yy < h; yy++) {
         uint32_t *row = (uint32_t *)(fb->buf + (y + yy) * fb->pitch);
-        for (uint32_t xx = 0; xx < w; xx++) {
-            row[x + xx] = color;
-        }
+        fb_span_fill(row + x, color, w);
+    }
+}
+
+// Clip a w x h block at (dx, dy) against fb's clip and src's bounds,
+// adjusting the source origin to match
+static bool clip_blit(const framebuffer_t *fb, const framebuffer_t *src,
+                      int32_t *dx, int32_t *dy, int32_t *sx, int32_t *sy,
+                      int32_t *w, int32_t *h) {
+    fb_rect_t s = { *sx, *sy, *w, *h };
+    fb_rect_t src_bounds = { 0, 0, (int32_t)src->width, (int32_t)src->height };
+    if (!fb_rect_intersect(&s, &src_bounds, &s))
+        return false;
+
+    fb_rect_t d = { *dx + (s.x - *sx), *dy + (s.y - *sy), s.w, s.h };
+    fb_rect_t out;
+    if (!fb_rect_intersect(&d, &fb->clip, &out))
+        return false;
+
+    *sx = s.x + (out.x - d.x);
+    *sy = s.y + (out.y - d.y);
+    *dx = out.x;
+    *dy = out.y;
+    *w = out.w;
+    *h = out.h;
+    return true;
+}
+
+void fb_copy_rect(framebuffer_t *fb, int32_t dx, int32_t dy,
+                  const framebuffer_t *src, int32_t sx, int32_t sy,
+                  int32_t w, int32_t h) {
+    if (fb->dl) {
+        fb_cmd_t c = { .op = FB_OP_COPY, .arg = { dx, dy, sx, sy, w, h }, .src = src };
+        fb_rect_t b = { dx, dy, w, h };
+        fb_dl_add(fb, &c, &b, 0);
+        return;
+    }
+
+    if (!clip_blit(fb, src, &dx, &dy, &sx, &sy, &w, &h))
+        return;
+
+    for (int32_t yy = 0; yy < h; yy++) {
+        uint32_t *d = (uint32_t *)(fb->buf + (dy + yy) * fb->pitch) + dx;
+        const uint32_t *s = (const uint32_t *)(src->buf + (sy + yy) * src->pitch) + sx;
+        fb_span_copy(d, s, w);
+    }
+}
+
+void fb_blit_keyed(framebuffer_t *fb, int32_t dx, int32_t dy,
+                   const framebuffer_t *src, int32_t sx, int32_t sy,
+                   int32_t w, int32_t h, uint32_t key) {
+    if (fb->dl) {
+        fb_cmd_t c = { .op = FB_OP_BLIT_KEYED, .arg = { dx, dy, sx, sy, w, h },
+                       .color = key, .src = src };
+        fb_rect_t b = { dx, dy, w, h };
+        fb_dl_add(fb, &c, &b, 0);
+        return;
+    }
+
+    if (!clip_blit(fb, src, &dx, &dy, &sx, &sy, &w, &h))
+        return;
+
+    for (int32_t yy = 0; yy < h; yy++) {
+        uint32_t *d = (uint32_t *)(fb->buf + (dy + yy) * fb->pitch) + dx;
+        const uint32_t *s = (const uint32_t *)(src->buf + (sy + yy) * src->pitch) + sx;
+        fb_span_blit_keyed(d, s, key, w);
     }
 }
 
@@ -152,6 +371,19 @@ void fb_draw_char(framebuffer_t *fb, uint32_t x, uint32_t y, char c, uint32_t co
     if (c < 32 || c > 126)
         return;
 
+    if (fb->dl) {
+        fb_cmd_t cmd = { .op = FB_OP_CHAR, .arg = { (int32_t)x, (int32_t)y, c }, .color = color };
+        fb_rect_t b = { (int32_t)x, (int32_t)y, 8, 12 };
+        fb_dl_add(fb, &cmd, &b, 0);
+        return;
+    }
+
+    // Skip cells that lie entirely outside the clip rectangle
+    int32_t cx = (int32_t)x, cy = (int32_t)y;
+    if (cx >= fb->clip.x + fb->clip.w || cx + 8 <= fb->clip.x ||
+        cy >= fb->clip.y + fb->clip.h || cy + 12 <= fb->clip.y)
+        return;
+
     const uint8_t *glyph = font8x12[c - 32];
 
     for (int row = 0; row < 12; row++) {
@@ -166,6 +398,17 @@ void fb_draw_char(framebuffer_t *fb, uint32_t x, uint32_t y, char c, uint32_t co
 
 
 void fb_draw_text(framebuffer_t *fb, uint32_t x, uint32_t y, const char *s, uint32_t color) {
+    if (fb->dl) {
+        int32_t len = 0;
+        while (s[len])
+            len++;
+
+        fb_cmd_t c = { .op = FB_OP_TEXT, .arg = { (int32_t)x, (int32_t)y }, .color = color };
+        fb_rect_t b = { (int32_t)x, (int32_t)y, len * 8, 12 };
+        fb_dl_add(fb, &c, &b, s);
+        return;
+    }
+
     while (*s) {
         fb_draw_char(fb, x, y, *s, color);
         x += 8;
@@ -173,7 +416,81 @@ void fb_draw_text(framebuffer_t *fb, uint32_t x, uint32_t y, const char *s, uint
     }
 }
 
+// ------------------------------------------------------------
+// Span-based text
+// ------------------------------------------------------------
+
+// glyph_mask[bits][col] is all-ones where font bit (7 - col) is set.
+// Built by the compiler, so there is no setup and nothing to race on.
+#define GM(b, col)  ((((b) >> (7 - (col))) & 1) ? 0xFFFFFFFFu : 0)
+#define GM_ROW(b)   { GM(b, 0), GM(b, 1), GM(b, 2), GM(b, 3), \
+                      GM(b, 4), GM(b, 5), GM(b, 6), GM(b, 7) }
+#define GM_ROW4(b)  GM_ROW(b), GM_ROW((b) + 1), GM_ROW((b) + 2), GM_ROW((b) + 3)
+#define GM_ROW16(b) GM_ROW4(b), GM_ROW4((b) + 4), GM_ROW4((b) + 8), GM_ROW4((b) + 12)
+
+static const uint32_t glyph_mask[256][8] __attribute__((aligned(16))) = {
+    GM_ROW16(0x00), GM_ROW16(0x10), GM_ROW16(0x20), GM_ROW16(0x30),
+    GM_ROW16(0x40), GM_ROW16(0x50), GM_ROW16(0x60), GM_ROW16(0x70),
+    GM_ROW16(0x80), GM_ROW16(0x90), GM_ROW16(0xA0), GM_ROW16(0xB0),
+    GM_ROW16(0xC0), GM_ROW16(0xD0), GM_ROW16(0xE0), GM_ROW16(0xF0),
+};
+
+void fb_draw_text_bg(framebuffer_t *fb, int32_t x, int32_t y, const char *s,
+                     uint32_t fg, uint32_t bg) {
+    int32_t len = 0;
+    while (s[len])
+        len++;
+
+    // Clip the whole string once
+    fb_rect_t r = { x, y, len * 8, 12 };
+
+    if (fb->dl) {
+        fb_cmd_t c = { .op = FB_OP_TEXT_BG, .arg = { x, y }, .color = fg, .bg = bg };
+        fb_dl_add(fb, &c, &r, s);
+        return;
+    }
+
+    if (!fb_rect_intersect(&r, &fb->clip, &r))
+        return;
+
+    int32_t first = (r.x - x) / 8;              // first visible char
+    int32_t last = (r.x + r.w - 1 - x) / 8;     // last visible char
+    uint32_t diff = fg ^ bg;
+
+    for (int32_t row = r.y - y; row < r.y + r.h - y; row++) {
+        uint32_t *dst = (uint32_t *)(fb->buf + (y + row) * fb->pitch);
+
+        for (int32_t i = first; i <= last; i++) {
+            char c = s[i];
+            if (c < 32 || c > 126)
+                c = ' ';
+
+            const uint32_t *m = glyph_mask[font8x12[c - 32][row]];
+            int32_t gx = x + i * 8;
+            uint32_t *p = dst + gx;
+
+            if (gx >= r.x && gx + 8 <= r.x + r.w) {
+                fb_glyph8(p, m, fg, bg);
+            } else {
+                // Partially clipped glyph at either end of the string
+                int32_t c0 = gx < r.x ? r.x - gx : 0;
+                int32_t c1 = gx + 8 > r.x + r.w ? r.x + r.w - gx : 8;
+                for (int32_t col = c0; col < c1; col++)
+                    p[col] = bg ^ (diff & m[col]);
+            }
+        }
+    }
+}
+
 void fb_draw_line(framebuffer_t *fb, int x0, int y0, int x1, int y1, uint32_t color) {
+    if (fb->dl) {
+        fb_cmd_t c = { .op = FB_OP_LINE, .arg = { x0, y0, x1, y1 }, .color = color };
+        fb_rect_t b = { x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1,
+                        iabs(x1 - x0) + 1, iabs(y1 - y0) + 1 };
+        fb_dl_add(fb, &c, &b, 0);
+        return;
+    }
+
     int dx = iabs(x1 - x0), sx = x0 < x1 ? 1 : -1;
     int dy = -iabs(y1 - y0), sy = y0 < y1 ? 1 : -1;
     int err = dx + dy, e2;
@@ -191,9 +508,22 @@ void fb_draw_line(framebuffer_t *fb, int x0, int y0, int x1, int y1, uint32_t co
 void fb_draw_arc(framebuffer_t *fb, int cx, int cy, int r,
                  int start_deg, int end_deg, uint32_t color)
 {
+    if (fb->dl) {
+        // |sin_table| <= 32768, so no point lands past r + 1
+        int reach = iabs(r) + 1;
+        fb_cmd_t c = { .op = FB_OP_ARC, .arg = { cx, cy, r, start_deg, end_deg }, .color = color };
+        fb_rect_t b = { cx - reach, cy - reach, 2 * reach + 1, 2 * reach + 1 };
+        fb_dl_add(fb, &c, &b, 0);
+        return;
+    }
+
     start_deg = (start_deg % 360 + 360) % 360;
     end_deg   = (end_deg   % 360 + 360) % 360;
 
+    // Arcs that cross 0° (e.g. -120..120) wrap past 360
+    if (end_deg < start_deg)
+        end_deg += 360;
+
     // Oversample 4× for smooth arcs
     for (int a = start_deg * 4; a <= end_deg * 4; a++) {
         int deg = a / 4;
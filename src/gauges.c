@@ -1,24 +1,31 @@
 #include "gauges.h"
 #include "framebuffer.h"
+#include "compositor.h"
 #include <stdint.h>
 
 extern const int16_t sin_table[360];
 
-void draw_rpm_gauge(framebuffer_t *fb, int cx, int cy, int r, int rpm)
-{
-    // Clear gauge area
-    fb_fill_rect(fb, cx - r - 5, cy - r - 5, (r * 2) + 10, (r * 2) + 10, 0x00000000);
+#define FACE_BG     0x00000000  // also the transparent key when blitting
+#define FACE_FG     0x00FFFFFF
+#define FACE_RED    0x00FF0000
+#define NEEDLE      0x00FF0000
 
-    // Draw arc from -120° to +120°
-    fb_draw_arc(fb, cx, cy, r, -120, 120, 0x00FFFFFF);
+// Backing store for pre-rendered faces: one 150px-radius gauge
+#define FACE_POOL_PIXELS (320 * 320)
+
+static uint32_t face_pool[FACE_POOL_PIXELS] __attribute__((aligned(16)));
+static uint32_t face_pool_used = 0;
 
+// Point at radius rad along the gauge sweep for a given RPM
+static void gauge_point(int cx, int cy, int rad, int rpm, int *x, int *y)
+{
     // Clamp RPM
     if (rpm < 0) rpm = 0;
-    if (rpm > 8000) rpm = 8000;
+    if (rpm > RPM_GAUGE_MAX) rpm = RPM_GAUGE_MAX;
 
     // Map RPM (0..8000) → angle (-120..120)
     // integer math: angle = -120 + (rpm * 240) / 8000
-    int angle = -120 + (rpm * 240) / 8000;
+    int angle = -120 + (rpm * 240) / RPM_GAUGE_MAX;
 
     // Normalize to 0..359
     int a = (angle % 360 + 360) % 360;
@@ -29,11 +36,118 @@ void draw_rpm_gauge(framebuffer_t *fb, int cx, int cy, int r, int rpm)
     // cos(a) = sin(a - 90) = sin(a + 270)
     int ca = sin_table[(a + 270) % 360];
 
-    // Compute needle endpoint
-    int x = cx + (ca * (r - 10)) / 32767;
-    int y = cy - (sa * (r - 10)) / 32767;
+    *x = cx + (ca * rad) / 32767;
+    *y = cy - (sa * rad) / 32767;
+}
+
+static void needle_tip(const rpm_gauge_t *g, int rpm, int *x, int *y)
+{
+    gauge_point(g->cx, g->cy, g->r - 10, rpm, x, y);
+}
+
+static void render_face(rpm_gauge_t *g)
+{
+    framebuffer_t *f = &g->face;
+    int c = g->r + 5;   // centre in face coordinates
+    int r = g->r;
+
+    fb_fill_rect(f, 0, 0, f->width, f->height, FACE_BG);
+
+    // Redline band: a few concentric arcs just inside the rim
+    int red_start = -120 + (RPM_GAUGE_REDLINE * 240) / RPM_GAUGE_MAX;
+    for (int band = 2; band <= 6; band++)
+        fb_draw_arc(f, c, c, r - band, red_start, 120, FACE_RED);
+
+    // Draw arc from -120° to +120°
+    fb_draw_arc(f, c, c, r, -120, 120, FACE_FG);
+
+    // Ticks every 500 RPM, long ones with a label every 1000
+    for (int rpm = 0; rpm <= RPM_GAUGE_MAX; rpm += 500) {
+        int major = (rpm % 1000) == 0;
+        int x0, y0, x1, y1;
+        gauge_point(c, c, r - (major ? 14 : 7), rpm, &x0, &y0);
+        gauge_point(c, c, r, rpm, &x1, &y1);
+        fb_draw_line(f, x0, y0, x1, y1, rpm >= RPM_GAUGE_REDLINE ? FACE_RED : FACE_FG);
+
+        if (major) {
+            char label[2] = { (char)('0' + rpm / 1000), 0 };
+            int lx, ly;
+            gauge_point(c, c, r - 26, rpm, &lx, &ly);
+            fb_draw_text(f, lx - 4, ly - 6, label, FACE_FG);
+        }
+    }
+}
+
+static void needle_bounds(const rpm_gauge_t *g, fb_rect_t *out)
+{
+    int x0 = g->cx < g->needle_x ? g->cx : g->needle_x;
+    int y0 = g->cy < g->needle_y ? g->cy : g->needle_y;
+    int x1 = g->cx > g->needle_x ? g->cx : g->needle_x;
+    int y1 = g->cy > g->needle_y ? g->cy : g->needle_y;
+
+    out->x = x0;
+    out->y = y0;
+    out->w = x1 - x0 + 1;
+    out->h = y1 - y0 + 1;
+}
+
+static void rpm_gauge_draw(framebuffer_t *fb, const fb_rect_t *clip, void *ctx)
+{
+    rpm_gauge_t *g = ctx;
+
+    // Restore the face under the clip; background pixels stay transparent
+    // so anything drawn beneath the gauge box shows through
+    fb_blit_keyed(fb, clip->x, clip->y, &g->face,
+                  clip->x - g->widget.bounds.x, clip->y - g->widget.bounds.y,
+                  clip->w, clip->h, FACE_BG);
 
     // Draw needle
-    fb_draw_line(fb, cx, cy, x, y, 0x00FF0000);
+    fb_draw_line(fb, g->cx, g->cy, g->needle_x, g->needle_y, NEEDLE);
+}
+
+bool rpm_gauge_init(rpm_gauge_t *g, int cx, int cy, int r)
+{
+    uint32_t side = (r * 2) + 10;
+    if (face_pool_used + side * side > FACE_POOL_PIXELS)
+        return false;
+
+    fb_init_surface(&g->face, face_pool + face_pool_used, side, side);
+    face_pool_used += side * side;
+
+    g->cx = cx;
+    g->cy = cy;
+    g->r = r;
+    g->rpm = 0;
+    needle_tip(g, 0, &g->needle_x, &g->needle_y);
+
+    g->widget.bounds.x = cx - r - 5;
+    g->widget.bounds.y = cy - r - 5;
+    g->widget.bounds.w = (r * 2) + 10;
+    g->widget.bounds.h = (r * 2) + 10;
+    g->widget.draw = rpm_gauge_draw;
+    g->widget.ctx = g;
+    g->widget.opaque = false;
+
+    render_face(g);
+    return true;
 }
 
+void rpm_gauge_set(rpm_gauge_t *g, int rpm)
+{
+    int x, y;
+    needle_tip(g, rpm, &x, &y);
+    g->rpm = rpm;
+
+    if (x == g->needle_x && y == g->needle_y)
+        return;
+
+    fb_rect_t old_r, new_r;
+    needle_bounds(g, &old_r);
+
+    g->needle_x = x;
+    g->needle_y = y;
+    needle_bounds(g, &new_r);
+
+    comp_damage(&old_r);
+    comp_damage(&new_r);
+}
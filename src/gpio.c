@@ -4,6 +4,11 @@
 #define GPFSEL(pin)   (GPIO_BASE + ((pin) / 10) * 4)
 #define GPSET0        (GPIO_BASE + 0x1C)
 #define GPCLR0        (GPIO_BASE + 0x28)
+#define GPLEV0        (GPIO_BASE + 0x34)
+#define GPEDS0        (GPIO_BASE + 0x40)
+#define GPAFEN0       (GPIO_BASE + 0x88)
+#define GPPUD         (GPIO_BASE + 0x94)
+#define GPPUDCLK0     (GPIO_BASE + 0x98)
 
 void gpio_set_alt(uint32_t pin, uint32_t alt) {
     uintptr_t reg = GPFSEL(pin);
@@ -29,3 +34,43 @@ void gpio_write(uint32_t pin, uint32_t value) {
     else
         mmio_write(GPCLR0, 1u << pin);
 }
+
+void gpio_set_input(uint32_t pin) {
+    uintptr_t reg = GPFSEL(pin);
+    uint32_t shift = (pin % 10) * 3;
+    uint32_t val = mmio_read(reg);
+    val &= ~(7u << shift);
+    mmio_write(reg, val);
+}
+
+static void gpio_wait_cycles(uint32_t n) {
+    while (n--)
+        __asm__ volatile("nop");
+}
+
+void gpio_set_pull(uint32_t pin, gpio_pull_t pull) {
+    // BCM2837 sequence: set control, clock it into the pin, release
+    mmio_write(GPPUD, pull);
+    gpio_wait_cycles(150);
+    mmio_write(GPPUDCLK0, 1u << pin);
+    gpio_wait_cycles(150);
+    mmio_write(GPPUD, 0);
+    mmio_write(GPPUDCLK0, 0);
+}
+
+uint32_t gpio_read(uint32_t pin) {
+    return (mmio_read(GPLEV0) >> pin) & 1;
+}
+
+void gpio_enable_falling_edge(uint32_t pin) {
+    // Asynchronous detect: catches edges shorter than a sample clock
+    mmio_write(GPAFEN0, mmio_read(GPAFEN0) | (1u << pin));
+}
+
+uint32_t gpio_event_pending(uint32_t pin) {
+    return (mmio_read(GPEDS0) >> pin) & 1;
+}
+
+void gpio_clear_event(uint32_t pin) {
+    mmio_write(GPEDS0, 1u << pin);
+}
@@ -0,0 +1,246 @@
+#include "irq.h"
+#include "peripherals.h"
+#include "smp.h"
+#include "sync.h"
+#include "uart.h"
+#include "fmt.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Legacy controller
+#define IRQ_BASIC_PENDING   (IRQ_BASE + 0x00)
+#define IRQ_PENDING1        (IRQ_BASE + 0x04)
+#define IRQ_PENDING2        (IRQ_BASE + 0x08)
+#define IRQ_ENABLE1         (IRQ_BASE + 0x10)
+#define IRQ_ENABLE2         (IRQ_BASE + 0x14)
+#define IRQ_ENABLE_BASIC    (IRQ_BASE + 0x18)
+#define IRQ_DISABLE1        (IRQ_BASE + 0x1C)
+#define IRQ_DISABLE2        (IRQ_BASE + 0x20)
+#define IRQ_DISABLE_BASIC   (IRQ_BASE + 0x24)
+
+// Basic pending: bit 8/9 flag pending register 1/2, and bits 10-20 are
+// shortcuts for IRQs 7, 9, 10, 18, 19 (bank 1) and 53-57, 62 (bank 2)
+// that do not set bit 8/9
+#define BASIC_ARM_MASK      0x000000FFu
+#define BASIC_BANK1_MASK    0x00007D00u
+#define BASIC_BANK2_MASK    0x001F8200u
+
+// ARM-local controller
+#define LOCAL_GPU_ROUTING   (LOCAL_PERIPH_BASE + 0x0C)
+#define LOCAL_PMU_SET       (LOCAL_PERIPH_BASE + 0x10)
+#define LOCAL_PMU_CLR       (LOCAL_PERIPH_BASE + 0x14)
+#define LOCAL_TIMER_ROUTING (LOCAL_PERIPH_BASE + 0x24)
+#define LOCAL_TIMER_CTRL    (LOCAL_PERIPH_BASE + 0x34)
+#define LOCAL_TIMER_IRQ_CTRL(n) (LOCAL_PERIPH_BASE + 0x40 + 4 * (n))
+#define LOCAL_MBOX_IRQ_CTRL(n)  (LOCAL_PERIPH_BASE + 0x50 + 4 * (n))
+#define LOCAL_IRQ_SOURCE(n)     (LOCAL_PERIPH_BASE + 0x60 + 4 * (n))
+
+#define LOCAL_SRC_GPU       (1u << 8)
+#define LOCAL_TIMER_INT_EN  (1u << 29)
+
+typedef struct {
+    irq_fn fn;
+    void *ctx;
+} irq_entry_t;
+
+// Written by the owning core only: no atomics on the IRQ path
+typedef struct {
+    uint32_t count;
+    uint32_t spurious;
+    uint64_t max_ticks;     // CNTPCT ticks
+} irq_core_stats_t;
+
+static irq_entry_t table[IRQ_NUM];
+static irq_core_stats_t stats[SMP_NUM_CORES][IRQ_NUM];
+static uint32_t taken[SMP_NUM_CORES];
+
+// Enabled legacy sources: the pending registers are masked with these
+static uint32_t enabled[3];
+
+static inline uint64_t cntpct(void) {
+    uint64_t t;
+    __asm__ volatile("mrs %0, cntpct_el0" : "=r"(t));
+    return t;
+}
+
+void irq_init(void) {
+    mmio_write(IRQ_DISABLE1, 0xFFFFFFFF);
+    mmio_write(IRQ_DISABLE2, 0xFFFFFFFF);
+    mmio_write(IRQ_DISABLE_BASIC, 0xFFFFFFFF);
+
+    for (uint32_t n = 0; n < SMP_NUM_CORES; n++) {
+        mmio_write(LOCAL_TIMER_IRQ_CTRL(n), 0);
+        mmio_write(LOCAL_MBOX_IRQ_CTRL(n), 0);
+    }
+    mmio_write(LOCAL_PMU_CLR, 0xFF);
+    mmio_write(LOCAL_TIMER_CTRL, mmio_read(LOCAL_TIMER_CTRL) & ~LOCAL_TIMER_INT_EN);
+
+    enabled[0] = enabled[1] = enabled[2] = 0;
+    irq_route_gpu(0);
+}
+
+void irq_register(uint32_t irq, irq_fn fn, void *ctx) {
+    if (irq >= IRQ_NUM)
+        return;
+
+    // The IRQ path may run on another core: ctx must be in place first
+    table[irq].ctx = ctx;
+    sync_store_rel(&table[irq].fn, fn);
+}
+
+void irq_route_gpu(uint32_t core) {
+    mmio_write(LOCAL_GPU_ROUTING, core & 3);
+}
+
+// ------------------------------------------------------------
+// Enable / disable
+// ------------------------------------------------------------
+
+static void local_set(uint32_t bit, bool on) {
+    uint32_t core = smp_core_id();
+    uintptr_t reg;
+    uint32_t mask;
+
+    if (bit < 4) {
+        reg = LOCAL_TIMER_IRQ_CTRL(core);
+        mask = 1u << bit;
+    } else if (bit < 8) {
+        reg = LOCAL_MBOX_IRQ_CTRL(core);
+        mask = 1u << (bit - 4);
+    } else if (bit == 9) {
+        mmio_write(on ? LOCAL_PMU_SET : LOCAL_PMU_CLR, 1u << core);
+        return;
+    } else if (bit == 11) {
+        // One local timer for the chip: it interrupts the enabling core
+        if (on)
+            mmio_write(LOCAL_TIMER_ROUTING, core);
+        reg = LOCAL_TIMER_CTRL;
+        mask = LOCAL_TIMER_INT_EN;
+    } else {
+        return;     // GPU line and AXI: not separately maskable here
+    }
+
+    uint32_t v = mmio_read(reg);
+    mmio_write(reg, on ? v | mask : v & ~mask);
+}
+
+void irq_enable(uint32_t irq) {
+    if (irq < 64) {
+        sync_fetch_or(&enabled[irq / 32], 1u << (irq % 32));
+        mmio_write(irq < 32 ? IRQ_ENABLE1 : IRQ_ENABLE2, 1u << (irq % 32));
+    } else if (irq < IRQ_LOCAL(0)) {
+        sync_fetch_or(&enabled[2], 1u << (irq - 64));
+        mmio_write(IRQ_ENABLE_BASIC, 1u << (irq - 64));
+    } else if (irq < IRQ_NUM) {
+        local_set(irq - IRQ_LOCAL(0), true);
+    }
+}
+
+void irq_disable(uint32_t irq) {
+    if (irq < 64) {
+        mmio_write(irq < 32 ? IRQ_DISABLE1 : IRQ_DISABLE2, 1u << (irq % 32));
+        sync_fetch_and(&enabled[irq / 32], ~(1u << (irq % 32)));
+    } else if (irq < IRQ_LOCAL(0)) {
+        mmio_write(IRQ_DISABLE_BASIC, 1u << (irq - 64));
+        sync_fetch_and(&enabled[2], ~(1u << (irq - 64)));
+    } else if (irq < IRQ_NUM) {
+        local_set(irq - IRQ_LOCAL(0), false);
+    }
+}
+
+// ------------------------------------------------------------
+// Dispatch
+// ------------------------------------------------------------
+
+static void run(uint32_t irq, irq_core_stats_t *st) {
+    irq_fn fn = sync_load_acq(&table[irq].fn);
+
+    // Nobody to clear it: it would fire again at once
+    if (!fn) {
+        st[irq].spurious++;
+        irq_disable(irq);
+        return;
+    }
+
+    uint64_t t0 = cntpct();
+    fn(irq, table[irq].ctx);
+    uint64_t dt = cntpct() - t0;
+
+    st[irq].count++;
+    if (dt > st[irq].max_ticks)
+        st[irq].max_ticks = dt;
+}
+
+static void run_bits(uint32_t bits, uint32_t base, irq_core_stats_t *st) {
+    while (bits) {
+        run(base + __builtin_ctz(bits), st);
+        bits &= bits - 1;
+    }
+}
+
+void irq_dispatch(void) {
+    uint32_t core = smp_core_id();
+    irq_core_stats_t *st = stats[core];
+    uint32_t src = mmio_read(LOCAL_IRQ_SOURCE(core));
+
+    sync_store_rlx(&taken[core], taken[core] + 1);
+    run_bits(src & ~LOCAL_SRC_GPU, IRQ_LOCAL(0), st);
+
+    if (!(src & LOCAL_SRC_GPU))
+        return;
+
+    // Switching peripherals: the local block above, the legacy one here
+    uint32_t basic = mmio_read_ordered(IRQ_BASIC_PENDING);
+
+    run_bits(basic & BASIC_ARM_MASK & sync_load_rlx(&enabled[2]), 64, st);
+    if (basic & BASIC_BANK1_MASK)
+        run_bits(mmio_read(IRQ_PENDING1) & sync_load_rlx(&enabled[0]), 0, st);
+    if (basic & BASIC_BANK2_MASK)
+        run_bits(mmio_read(IRQ_PENDING2) & sync_load_rlx(&enabled[1]), 32, st);
+}
+
+uint32_t irq_taken(void) {
+    return sync_load_rlx(&taken[smp_core_id()]);
+}
+
+void irq_get_stats(uint32_t irq, irq_stats_t *out) {
+    uint64_t max_ticks = 0;
+    uint64_t freq;
+
+    out->count = 0;
+    out->spurious = 0;
+    if (irq >= IRQ_NUM) {
+        out->max_ns = 0;
+        return;
+    }
+
+    for (uint32_t n = 0; n < SMP_NUM_CORES; n++) {
+        out->count += stats[n][irq].count;
+        out->spurious += stats[n][irq].spurious;
+        if (stats[n][irq].max_ticks > max_ticks)
+            max_ticks = stats[n][irq].max_ticks;
+    }
+
+    __asm__ volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+    out->max_ns = freq ? (uint32_t)(max_ticks * 1000000000u / freq) : 0;
+}
+
+// ------------------------------------------------------------
+// Synchronous exceptions
+// ------------------------------------------------------------
+
+// Called from the vector in start.S; a fault at EL1 is not recoverable
+void exc_report(uint64_t esr, uint64_t elr, uint64_t far) {
+    char buf[16];
+
+    uart_puts("\nEXCEPTION esr ");
+    buf[fmt_u32_hex(buf, (uint32_t)esr, 8)] = 0;
+    uart_puts(buf);
+    uart_puts(" elr ");
+    buf[fmt_u32_hex(buf, (uint32_t)elr, 8)] = 0;
+    uart_puts(buf);
+    uart_puts(" far ");
+    buf[fmt_u32_hex(buf, (uint32_t)far, 8)] = 0;
+    uart_puts(buf);
+    uart_puts("\n");
+}
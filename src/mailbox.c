@@ -1,5 +1,6 @@
 #include "peripherals.h"
 #include "mailbox.h"
+#include "mmu.h"
 
 #define MBOX_READ    (MBOX_BASE + 0x00)
 #define MBOX_STATUS  (MBOX_BASE + 0x18)
@@ -15,10 +16,14 @@ bool mbox_call(uint8_t ch, volatile uint32_t *mbox) {
         return false; // must be 16-byte aligned
 
     uint32_t msg = addr | (ch & 0xF);
+    uint32_t size = mbox[0];
+
+    // The GPU reads and writes the buffer in memory, behind the D-cache
+    dcache_clean_range(mbox, size);
 
     while (mmio_read(MBOX_STATUS) & MBOX_FULL) { }
 
-    mmio_write(MBOX_WRITE, msg);
+    mmio_write_ordered(MBOX_WRITE, msg);
 
     for (;;) {
         while (mmio_read(MBOX_STATUS) & MBOX_EMPTY) { }
@@ -28,6 +33,7 @@ bool mbox_call(uint8_t ch, volatile uint32_t *mbox) {
         if ((resp & 0xF) == (ch & 0xF) &&
             (resp & ~0xF) == addr) {
 
+            dcache_invalidate_range(mbox, size);
             return mbox[1] == 0x80000000;
         }
     }
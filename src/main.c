@@ -1,149 +1,642 @@
 #include "mcp2515.h"
+#include "can_ring.h"
+#include "can_db.h"
+#include "can_dispatch.h"
 #include "framebuffer.h"
+#include "fb_tiles.h"
 #include "uart.h"
 #include "timer.h"
 #include "gauges.h"
+#include "compositor.h"
+#include "irq.h"
+#include "fmt.h"
+#include "can_stats.h"
+#include "console.h"
+#include "smp.h"
+#include "sync.h"
+#include "tasks.h"
 #include <stdio.h>
 
 #define MAX_LOG_LINES 30
-
-// Set this to the CAN ID that carries RPM
-#define RPM_CAN_ID 0x0CFF1234
+#define LOG_X         10
+#define LOG_Y         10
+#define LOG_LINE_H    12
+#define LOG_LINE_W    (64 * 8)
+
+// Repaint at most once per display frame (~60 Hz)
+#define FRAME_US      16667
+
+// The stats page redraws twice a second while shown
+#define STATS_REFRESH_US 500000
+#define STATS_W       (CAN_STATS_LINE_MAX * 8)
+
+// First rate the autobaud search tries; the others follow in table order
+#define CAN_BITRATE   MCP_BITRATE_500K
+// Boot waits this long for the bitrate to lock (one sweep of the table),
+// then the search carries on behind the UI
+#define AUTOBAUD_BOOT_US 1000000
+// CAN housekeeping period while the search runs (it reads CANINTF) and
+// once the bitrate is locked (bus-off back-off, bus load window)
+#define AUTOBAUD_POLL_US 500
+#define CAN_HOUSE_US     10000
+
+// Only messages in the signal DB (dbc/dash.dbc) pass the MCP2515
+// acceptance filters; everything else is rejected in silicon. Set
+// LOG_ALL_FRAMES to 1 to watch the whole bus.
+#define LOG_ALL_FRAMES 0
 
 static char log_lines[MAX_LOG_LINES][64];
 static int log_head = 0;
 
-static int fmt_u32_dec(char *buf, uint32_t v) {
-    char tmp[10];
-    int i = 0;
+// ------------------------------------------------------------
+// CAN logging
+// ------------------------------------------------------------
 
-    if (v == 0) {
-        buf[0] = '0';
-        return 1;
-    }
+static widget_t log_widget;
+
+static void damage_log_line(int idx) {
+    fb_rect_t r = {
+        LOG_X - 8, LOG_Y + idx * LOG_LINE_H, LOG_LINE_W + 8, LOG_LINE_H
+    };
+    comp_damage(&r);
+}
+
+static void log_can_frame(const can_frame_t *f, uint64_t ts) {
+    // Lines stay in fixed slots so a new frame only dirties its own row
+    // and the row that loses the cursor marker. The render core may be
+    // reading the slot: the rows are damaged only once it is rewritten,
+    // and byte 63 is never written, so a torn read still ends in the slot.
+    int idx = log_head;
+    int prev = (idx + MAX_LOG_LINES - 1) % MAX_LOG_LINES;
+    char *line = log_lines[idx];
 
-    while (v > 0) {
-        tmp[i++] = '0' + (v % 10);
-        v /= 10;
+    int n = 0;
+
+    // Receive time: seconds.microseconds since boot
+    n += fmt_u32_dec_w(line + n, (uint32_t)(ts / 1000000), 5);
+    line[n++] = '.';
+    n += fmt_u32_dec_z(line + n, (uint32_t)(ts % 1000000), 6);
+    line[n++] = ' ';
+
+    // ID: 3-digit hex, or 8 digits for 29-bit IDs
+    if (f->id & CAN_EFF_FLAG)
+        n += fmt_u32_hex(line + n, f->id & CAN_EFF_MASK, 8);
+    else
+        n += fmt_u32_hex(line + n, f->id, 3);
+    line[n++] = ' ';
+
+    // DLC: decimal
+    n += fmt_u32_dec(line + n, f->dlc);
+    line[n++] = ' ';
+
+    // Data bytes
+    for (uint8_t i = 0; i < f->dlc && n < 64 - 3; i++) {
+        n += fmt_u32_hex(line + n, f->data[i], 2);
+        line[n++] = ' ';
     }
 
-    for (int j = 0; j < i; j++)
-        buf[j] = tmp[i - j - 1];
+    line[n] = 0;
 
-    return i;
+    log_head = (idx + 1) % MAX_LOG_LINES;
+    damage_log_line(prev);
+    damage_log_line(idx);
 }
 
-static int fmt_u32_hex(char *buf, uint32_t v, int width) {
-    static const char hex[] = "0123456789ABCDEF";
-    char tmp[8];
-    int i = 0;
 
-    do {
-        tmp[i++] = hex[v & 0xF];
-        v >>= 4;
-    } while (v && i < 8);
+static void draw_log(framebuffer_t *fb, const fb_rect_t *clip, void *ctx) {
+    int newest = (log_head + MAX_LOG_LINES - 1) % MAX_LOG_LINES;
+
+    // Only visit the rows that intersect the clip
+    int first = (clip->y - LOG_Y) / LOG_LINE_H;
+    int last = (clip->y + clip->h - 1 - LOG_Y) / LOG_LINE_H;
+    if (first < 0) first = 0;
+    if (last >= MAX_LOG_LINES) last = MAX_LOG_LINES - 1;
 
-    while (i < width)
-        tmp[i++] = '0';
+    for (int i = first; i <= last; i++) {
+        int32_t y = LOG_Y + i * LOG_LINE_H;
+        int32_t n = 0;
+        while (log_lines[i][n])
+            n++;
 
-    for (int j = 0; j < i; j++)
-        buf[j] = tmp[i - j - 1];
+        // Rows are drawn opaque, padding included, so nothing is cleared first
+        fb_draw_text_bg(fb, LOG_X - 8, y, i == newest ? ">" : " ", 0x0000FF00, 0x00000000);
+        fb_draw_text_bg(fb, LOG_X, y, log_lines[i], 0x00FFFFFF, 0x00000000);
+        fb_fill_rect(fb, LOG_X + n * 8, y, LOG_LINE_W - n * 8, LOG_LINE_H, 0x00000000);
+    }
+}
+
+// ------------------------------------------------------------
+// End-to-end latency: INT edge of the oldest frame not yet on screen to
+// the page flip that shows it
+// ------------------------------------------------------------
+
+// The CAN role publishes the receive time of the first frame since the
+// last flush; the render role takes it just before the flush copies the
+// damage list, so that frame's damage, added before the publish, is in
+// the flush being timed
+static uint64_t lat_oldest_ts;                    // 0: nothing waiting
+static uint32_t lat_last, lat_max, lat_avg_q;     // µs, avg << 4
+
+// Ring order is receive order, so the first frame is the oldest
+static void lat_frame(uint64_t ts) {
+    uint64_t none = 0;
+    sync_cas(&lat_oldest_ts, &none, ts);
+}
 
-    return i;
+static uint64_t lat_take(void) {
+    return sync_xchg(&lat_oldest_ts, 0);
 }
 
+static void lat_flushed(uint64_t oldest, uint64_t now) {
+    if (!oldest)
+        return;
 
+    lat_last = (uint32_t)(now - oldest);
+    if (lat_last > lat_max)
+        lat_max = lat_last;
+    lat_avg_q += lat_last - (lat_avg_q >> 4);
+}
+
+static int lat_fmt(char *buf) {
+    int n = 0;
+
+    n += fmt_str(buf + n, "INT to pixels (us): last ");
+    n += fmt_u32_dec(buf + n, lat_last);
+    n += fmt_str(buf + n, ", avg ");
+    n += fmt_u32_dec(buf + n, lat_avg_q >> 4);
+    n += fmt_str(buf + n, ", max ");
+    n += fmt_u32_dec(buf + n, lat_max);
+    buf[n] = 0;
+    return n;
+}
 
 // ------------------------------------------------------------
-// CAN logging
+// Controller error state and frame loss, one line each
 // ------------------------------------------------------------
 
-static void log_can_frame(const can_frame_t *f) {
-    char *line = log_lines[log_head];
-    log_head = (log_head + 1) % MAX_LOG_LINES;
+// At most 67 characters
+static int err_fmt(char *buf) {
+    static const char *const state_names[] = { "error-active", "error-passive", "bus-off" };
+    mcp_err_stats_t e;
+    int n = 0;
+
+    mcp2515_err_stats(&e);
+
+    n += fmt_str(buf + n, state_names[e.state]);
+    n += fmt_str(buf + n, " TEC ");
+    n += fmt_u32_dec(buf + n, e.tec);
+    n += fmt_str(buf + n, " REC ");
+    n += fmt_u32_dec(buf + n, e.rec);
+    n += fmt_str(buf + n, ", bus-off ");
+    n += fmt_u32_dec(buf + n, e.to_bus_off);
+    n += fmt_str(buf + n, " reinit ");
+    n += fmt_u32_dec(buf + n, e.reinits);
+    buf[n] = 0;
+    return n;
+}
 
+// At most 53 characters
+static int loss_fmt(char *buf) {
+    mcp_err_stats_t e;
     int n = 0;
 
-    // ID: 3‑digit hex
-    n += fmt_u32_hex(line + n, f->id, 3);
-    line[n++] = ' ';
+    mcp2515_err_stats(&e);
 
-    // DLC: decimal
-    n += fmt_u32_dec(line + n, f->dlc);
-    line[n++] = ' ';
+    n += fmt_str(buf + n, "lost: ovr0 ");
+    n += fmt_u32_dec(buf + n, e.rx0_overflow);
+    n += fmt_str(buf + n, " ovr1 ");
+    n += fmt_u32_dec(buf + n, e.rx1_overflow);
+    n += fmt_str(buf + n, " ring ");
+    n += fmt_u32_dec(buf + n, e.rx_ring_full);
+    buf[n] = 0;
+    return n;
+}
 
-    // Data bytes
-    for (uint8_t i = 0; i < f->dlc && n < 64 - 3; i++) {
-        n += fmt_u32_hex(line + n, f->data[i], 2);
-        line[n++] = ' ';
+// ------------------------------------------------------------
+// Stats page: bus summary, errors, frame loss, latency, column header,
+// then one row per ID
+// ------------------------------------------------------------
+
+static widget_t stats_widget;
+
+static void draw_stats(framebuffer_t *fb, const fb_rect_t *clip, void *ctx) {
+    const can_id_stats_t *table = can_stats_table();
+    char buf[CAN_STATS_LINE_MAX];
+
+    int first = (clip->y - LOG_Y) / LOG_LINE_H;
+    int last = (clip->y + clip->h - 1 - LOG_Y) / LOG_LINE_H;
+    if (first < 0) first = 0;
+    if (last >= MAX_LOG_LINES) last = MAX_LOG_LINES - 1;
+
+    int row = 0, slot = 0;
+    for (; row <= last; row++) {
+        const char *text = "";
+
+        if (row == 0) {
+            can_stats_fmt_summary(buf);
+            text = buf;
+        } else if (row == 1) {
+            err_fmt(buf);
+            text = buf;
+        } else if (row == 2) {
+            loss_fmt(buf);
+            text = buf;
+        } else if (row == 3) {
+            lat_fmt(buf);
+            text = buf;
+        } else if (row == 4) {
+            text = can_stats_header;
+        } else {
+            while (slot < CAN_STATS_SLOTS && table[slot].count == 0)
+                slot++;
+            if (slot < CAN_STATS_SLOTS) {
+                if (row >= first)
+                    can_stats_fmt_row(buf, &table[slot]);
+                text = buf;
+                slot++;
+            }
+        }
+
+        if (row < first)
+            continue;
+
+        int32_t y = LOG_Y + row * LOG_LINE_H;
+        int32_t n = 0;
+        while (text[n])
+            n++;
+
+        fb_draw_text_bg(fb, LOG_X, y, text, 0x00FFFFFF, 0x00000000);
+        fb_fill_rect(fb, LOG_X + n * 8, y, STATS_W - n * 8, LOG_LINE_H, 0x00000000);
     }
+}
 
-    line[n] = 0;
+// ------------------------------------------------------------
+// Console commands
+// ------------------------------------------------------------
+
+static int layout_fmt(char *buf);
+static int idle_fmt(char *buf);
+
+static void cmd_stats(const char *args) {
+    char buf[CAN_STATS_LINE_MAX];
+
+    can_stats_dump();
+    err_fmt(buf);
+    uart_puts(buf);
+    uart_puts("\n");
+    loss_fmt(buf);
+    uart_puts(buf);
+    uart_puts("\n");
+    lat_fmt(buf);
+    uart_puts(buf);
+    uart_puts("\n");
+    layout_fmt(buf);
+    uart_puts(buf);
+    uart_puts("\n");
+    idle_fmt(buf);
+    uart_puts(buf);
+    uart_puts("\n");
 }
 
+static void cmd_idle(const char *args) {
+    char buf[CAN_STATS_LINE_MAX];
 
-static void draw_log(framebuffer_t *fb) {
-    fb_fill_rect(fb, 0, 0, fb->width, fb->height, 0x00000000);
+    idle_fmt(buf);
+    uart_puts(buf);
+    uart_puts("\n");
+}
 
-    int idx = log_head;
-    uint32_t y = 10;
+// One line per interrupt source that has fired
+static void cmd_irq(const char *args) {
+    char buf[CAN_STATS_LINE_MAX];
+
+    for (uint32_t irq = 0; irq < IRQ_NUM; irq++) {
+        irq_stats_t st;
+        irq_get_stats(irq, &st);
+        if (st.count == 0 && st.spurious == 0)
+            continue;
+
+        // At most 77 characters with the newline
+        int n = 0;
+        n += fmt_str(buf + n, "irq ");
+        n += fmt_u32_dec_w(buf + n, irq, 2);
+        n += fmt_str(buf + n, ": count ");
+        n += fmt_u32_dec(buf + n, st.count);
+        n += fmt_str(buf + n, ", spurious ");
+        n += fmt_u32_dec(buf + n, st.spurious);
+        n += fmt_str(buf + n, ", worst handler (ns) ");
+        n += fmt_u32_dec(buf + n, st.max_ns);
+        buf[n++] = '\n';
+        buf[n] = 0;
+        uart_puts(buf);
+    }
+}
+
+static task_t stats_task;
 
-    for (int i = 0; i < MAX_LOG_LINES; i++) {
-        const char *line = log_lines[idx];
-        fb_draw_text(fb, 10, y, line, 0x00FFFFFF);
-        y += 12;
-        idx = (idx + 1) % MAX_LOG_LINES;
+static void cmd_page(const char *args) {
+    if (args[0] != 's' && args[0] != 'l') {
+        uart_puts("page log|stats\n");
+        return;
     }
+
+    bool stats = args[0] == 's';
+    comp_show_widget(&log_widget, !stats);
+    comp_show_widget(&stats_widget, stats);
+    if (stats)
+        task_wake(&stats_task);
 }
 
 // ------------------------------------------------------------
-// RPM decoding (common format: ((A<<8)|B)/4 )
+// Signal handlers (run from can_dispatch once sig_values[] is fresh)
 // ------------------------------------------------------------
-static int decode_rpm(const can_frame_t *f) {
-    if (f->dlc < 2)
-        return 0;
+static void on_eec1(const can_frame_t *f, const can_msg_def_t *m, void *ctx) {
+    rpm_gauge_set(ctx, sig_values[SIG_EEC1_ENGINE_SPEED] / SIG_SCALE);
+}
+
+// ------------------------------------------------------------
+// Core layout
+//
+// The work is split into three roles, each a set of tasks (tasks.h):
+//   CAN     decode and stats after every IRQ on its core, where the INT
+//           service and SPI DMA completions run; bus-off and autobaud
+//           housekeeping on a timer
+//   render  one compositor flush per display frame, only while there
+//           is damage
+//   house   UART console when a key arrives, and the stats page refresh
+//           while it is shown, always on core 0
+// CORE_CAN and CORE_RENDER pick the core for the first two; roles on the
+// same core share its task list, so both at 0 is the single-core loop.
+// Compare layouts with the INT-to-pixel line of the "stats" command.
+// Between tasks each core sleeps in WFI, and draws tile bands for the
+// render role when a flush rings it (fb_tiles.h), one band per pass so
+// the CAN role is never held off for longer than a band takes. "idle"
+// shows how much of the time each core sleeps.
+// ------------------------------------------------------------
+
+#ifndef CORE_CAN
+#define CORE_CAN      1
+#endif
+#ifndef CORE_RENDER
+#define CORE_RENDER   2
+#endif
 
-    uint16_t raw = (f->data[0] << 8) | f->data[1];
-    return raw / 4;
+#if CORE_CAN >= SMP_NUM_CORES || CORE_RENDER >= SMP_NUM_CORES
+#error "CORE_CAN and CORE_RENDER must be cores 0-3"
+#endif
+
+static uint32_t can_core = CORE_CAN;
+static uint32_t render_core = CORE_RENDER;
+
+static int layout_fmt(char *buf) {
+    int n = 0;
+
+    n += fmt_str(buf + n, "layout: CAN on core ");
+    n += fmt_u32_dec(buf + n, can_core);
+    n += fmt_str(buf + n, ", render on core ");
+    n += fmt_u32_dec(buf + n, render_core);
+    buf[n] = 0;
+    return n;
+}
+
+// Share of the time each core slept since the last report
+static uint64_t idle_prev[SMP_NUM_CORES];
+static uint64_t idle_prev_at;
+
+static int idle_fmt(char *buf) {
+    uint64_t now = timer_get_counter();
+    uint64_t span = now - idle_prev_at;
+    int n = 0;
+
+    n += fmt_str(buf + n, "idle %:");
+    for (uint32_t core = 0; core < SMP_NUM_CORES; core++) {
+        uint64_t idle = tasks_idle_us(core, now);
+        uint64_t pct = span ? (idle - idle_prev[core]) * 100 / span : 0;
+
+        n += fmt_str(buf + n, " core ");
+        n += fmt_u32_dec(buf + n, core);
+        buf[n++] = ' ';
+        n += fmt_u32_dec(buf + n, pct > 100 ? 100 : (uint32_t)pct);
+        idle_prev[core] = idle;
+    }
+    buf[n] = 0;
+
+    idle_prev_at = now;
+    return n;
+}
+
+static mcp_bitrate_t stats_br;
+static uint64_t last_flush;
+
+static task_t can_rx_task, can_house_task, render_task, console_task;
+
+// Runs after every IRQ on the CAN core: frames arrive from the INT
+// service and the DMA completions
+static uint64_t can_rx(uint64_t now, void *ctx) {
+    can_ring_t *ring = mcp2515_rx_ring();
+
+    // Frames are read in place and released a batch at a time
+    const can_rx_t *batch;
+    uint32_t n;
+    while ((n = can_ring_peek(ring, &batch)) != 0) {
+        for (uint32_t i = 0; i < n; i++) {
+            const can_frame_t *f = &batch[i].frame;
+
+            can_stats_record(f, batch[i].ts);
+
+            // Log every frame
+            log_can_frame(f, batch[i].ts);
+
+            // Decode into sig_values[] and run the message's handler
+            can_dispatch(f);
+
+            // Last: the frame's damage is in by now
+            lat_frame(batch[i].ts);
+        }
+        can_ring_consume(ring, n);
+    }
+    return TASK_IDLE;
+}
+
+static uint64_t can_house(uint64_t now, void *ctx) {
+    can_stats_tick(now);
+    mcp2515_poll(now);
+
+    // Bus load is relative to the bitrate, which may lock late
+    if (!mcp2515_bitrate_locked())
+        return now + AUTOBAUD_POLL_US;
+
+    if (mcp2515_bitrate() != stats_br) {
+        stats_br = mcp2515_bitrate();
+        can_stats_init(stats_br);
+    }
+    return now + CAN_HOUSE_US;
+}
+
+// Woken by the first damage after a flush
+static void on_damage(void *ctx) {
+    task_wake(&render_task);
+}
+
+static uint64_t render(uint64_t now, void *ctx) {
+    // One repaint per display frame covers every frame received since
+    if (now - last_flush < FRAME_US)
+        return last_flush + FRAME_US;
+
+    uint64_t oldest = lat_take();
+    uint32_t pixels = comp_flush();
+    lat_flushed(oldest, timer_get_counter());
+    if (!pixels)
+        return TASK_IDLE;
+
+    // With two pages the next flush repaints this frame's damage into
+    // the other one, so run once more even if nothing else changes
+    last_flush = now;
+    return now + FRAME_US;
+}
+
+// The RX IRQ is masked here and unmasked by the console task, which then
+// reads the FIFO until it is empty
+static void uart_irq(uint32_t irq, void *ctx) {
+    uart_rx_irq(false);
+    task_wake(&console_task);
+}
+
+static uint64_t console(uint64_t now, void *ctx) {
+    uart_rx_irq(true);
+    console_poll();
+    return TASK_IDLE;
+}
+
+// Woken by "page stats"
+static uint64_t stats_refresh(uint64_t now, void *ctx) {
+    if (stats_widget.hidden)
+        return TASK_IDLE;
+
+    comp_damage_widget(&stats_widget);
+    return now + STATS_REFRESH_US;
+}
+
+static void add_task(task_t *t, task_fn fn, bool on_irq, uint32_t core) {
+    t->fn = fn;
+    t->ctx = 0;
+    t->on_irq = on_irq;
+    task_add(t, core);
+}
+
+static void core_loop(void *ctx) {
+    tasks_run();
 }
 
 // ------------------------------------------------------------
 // Main
 // ------------------------------------------------------------
 void main(void) {
+    static framebuffer_t fb;
+    char buf[CAN_STATS_LINE_MAX];
+
     uart_init();
     timer_init();
+    irq_init();
 
-    framebuffer_t fb;
     fb_init(&fb, 800, 480, 32);
     fb_clear(&fb, 0x00000000);
 
     uart_puts("CAN analyser starting\n");
 
-    if (!mcp2515_init(MCP_XTAL_16MHZ, MCP_BITRATE_500K)) {
+    if (!mcp2515_init(MCP_XTAL_16MHZ, CAN_BITRATE, MCP2515_AUTOBAUD)) {
         uart_puts("MCP2515 init failed\n");
         while (1) { }
     }
 
-    can_frame_t rx;
-    int rpm_value = 0;
-
-    while (1) {
-        if (mcp2515_recv(&rx)) {
+    uint64_t boot = timer_get_counter();
+    while (!mcp2515_bitrate_locked() && timer_get_counter() - boot < AUTOBAUD_BOOT_US) {
+        mcp2515_poll(timer_get_counter());
+        timer_delay_us(AUTOBAUD_POLL_US);
+    }
 
-            // Log every frame
-            log_can_frame(&rx);
-            draw_log(&fb);
+    if (!LOG_ALL_FRAMES) {
+        uint32_t wanted_ids[CAN_DB_NUM_MESSAGES];
+        for (uint32_t i = 0; i < CAN_DB_NUM_MESSAGES; i++)
+            wanted_ids[i] = can_db_messages[i].id;
 
-            // Check if this frame contains RPM
-            if (rx.id == RPM_CAN_ID) {
-                rpm_value = decode_rpm(&rx);
-            }
+        if (!mcp2515_set_filters(wanted_ids, CAN_DB_NUM_MESSAGES))
+            uart_puts("MCP2515: filter setup failed\n");
+    }
 
-            // Draw RPM gauge
-            draw_rpm_gauge(&fb, 400, 240, 150, rpm_value);
+    comp_init(&fb, 0x00000000);
+
+    log_widget.bounds.x = LOG_X - 8;
+    log_widget.bounds.y = LOG_Y;
+    log_widget.bounds.w = LOG_LINE_W + 8;
+    log_widget.bounds.h = MAX_LOG_LINES * LOG_LINE_H;
+    log_widget.draw = draw_log;
+    log_widget.ctx = 0;
+    log_widget.opaque = true;
+    comp_add_widget(&log_widget);
+
+    stats_widget.bounds.x = LOG_X;
+    stats_widget.bounds.y = LOG_Y;
+    stats_widget.bounds.w = STATS_W;
+    stats_widget.bounds.h = MAX_LOG_LINES * LOG_LINE_H;
+    stats_widget.draw = draw_stats;
+    stats_widget.ctx = 0;
+    stats_widget.opaque = true;
+    stats_widget.hidden = true;
+    comp_add_widget(&stats_widget);
+
+    static rpm_gauge_t rpm_gauge;
+    if (rpm_gauge_init(&rpm_gauge, 400, 240, 150)) {
+        comp_add_widget(&rpm_gauge.widget);
+        can_dispatch_register(CAN_MSG_EEC1, on_eec1, &rpm_gauge);
+    } else
+        uart_puts("RPM gauge: no room for face\n");
+
+    comp_flush();
+
+    stats_br = mcp2515_bitrate();
+    can_stats_init(stats_br);
+    console_register("stats", cmd_stats);
+    console_register("page", cmd_page);
+    console_register("irq", cmd_irq);
+    console_register("idle", cmd_idle);
+
+    uint64_t now = timer_get_counter();
+    last_flush = now;
+    idle_prev_at = now;
+
+    // Release cores 1-3, with or without a role: all of them draw tiles.
+    // They sleep until their tasks are added below. A role whose core
+    // does not come up runs on core 0 instead
+    for (uint32_t core = 1; core < SMP_NUM_CORES; core++) {
+        if (smp_start_core(core, core_loop, 0))
+            continue;
+
+        if (core == can_core) {
+            uart_puts("SMP: CAN core did not start\n");
+            can_core = 0;
+        }
+        if (core == render_core) {
+            uart_puts("SMP: render core did not start\n");
+            render_core = 0;
         }
-
-        timer_delay_us(1000);
     }
+    // CAN controller, SPI DMA and UART interrupts go to the CAN role's core
+    irq_route_gpu(can_core);
+
+    add_task(&can_rx_task, can_rx, true, can_core);
+    add_task(&can_house_task, can_house, false, can_core);
+    add_task(&render_task, render, false, render_core);
+    add_task(&console_task, console, false, 0);
+    add_task(&stats_task, stats_refresh, false, 0);
+    comp_on_damage(on_damage, 0);
+
+    irq_register(IRQ_UART, uart_irq, 0);
+    irq_enable(IRQ_UART);
+
+    layout_fmt(buf);
+    uart_puts(buf);
+    uart_puts("\n");
+
+    tasks_run();
 }
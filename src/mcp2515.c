@@ -1,218 +1,414 @@
 #include "mcp2515.h"
+#include "mcp2515_regs.h"
+#include "can_ring.h"
 #include "spi.h"
+#include "gpio.h"
+#include "irq.h"
 #include "timer.h"
 #include "uart.h"
 
-// MCP2515 registers (subset)
-#define MCP_CANCTRL   0x0F
-#define MCP_CANSTAT   0x0E
-#define MCP_CNF1      0x2A
-#define MCP_CNF2      0x29
-#define MCP_CNF3      0x28
-#define MCP_TXB0CTRL  0x30
-#define MCP_TXB0SIDH  0x31
-#define MCP_TXB0SIDL  0x32
-#define MCP_TXB0DLC   0x35
-#define MCP_TXB0D0    0x36
-#define MCP_RXB0CTRL  0x60
-#define MCP_RXB0SIDH  0x61
-#define MCP_RXB0SIDL  0x62
-#define MCP_RXB0DLC   0x65
-#define MCP_RXB0D0    0x66
-#define MCP_CANINTE   0x2B
-#define MCP_CANINTF   0x2C
-
-// SPI commands
-#define MCP_CMD_RESET      0xC0
-#define MCP_CMD_READ       0x03
-#define MCP_CMD_WRITE      0x02
-#define MCP_CMD_BITMOD     0x05
-#define MCP_CMD_READSTATUS 0xA0
-#define MCP_CMD_RTS_TXB0   0x81
-
-static void mcp_write_reg(uint8_t addr, uint8_t val) {
-    spi_cs_low();
-    spi_transfer(MCP_CMD_WRITE);
-    spi_transfer(addr);
-    spi_transfer(val);
-    spi_cs_high();
-}
-
-static uint8_t mcp_read_reg(uint8_t addr) {
-    spi_cs_low();
-    spi_transfer(MCP_CMD_READ);
-    spi_transfer(addr);
-    uint8_t v = spi_transfer(0x00);
-    spi_cs_high();
-    return v;
-}
-
-static void mcp_bit_modify(uint8_t addr, uint8_t mask, uint8_t data) {
-    spi_cs_low();
-    spi_transfer(MCP_CMD_BITMOD);
-    spi_transfer(addr);
-    spi_transfer(mask);
-    spi_transfer(data);
-    spi_cs_high();
+// RX ring: filled by mcp2515_isr(), emptied by mcp2515_recv() or a
+// batch consumer of mcp2515_rx_ring()
+static can_ring_t rx_ring;
+
+// DMA drain state: RX flags from the last CANINTF read still to be fetched
+static volatile bool rx_dma_running = false;
+static uint8_t rx_dma_pending = 0;
+
+// Receive timestamp for the frames being drained, µs on the system timer.
+// Frames seen by the first CANINTF read after an INT edge were already in
+// the controller at the edge, so they get the ISR entry time; frames
+// found by a later re-poll get the time of that poll.
+static uint64_t rx_stamp;
+static bool rx_restamp;
+
+void mcp_write_reg(uint8_t addr, uint8_t val) {
+    uint8_t tx[3] = { MCP_CMD_WRITE, addr, val };
+    spi_xfer(tx, 0, sizeof(tx));
+}
+
+void mcp_write_regs(uint8_t addr, const uint8_t *vals, uint8_t n) {
+    uint8_t tx[2 + 16];
+
+    if (n > 16)
+        n = 16;
+
+    tx[0] = MCP_CMD_WRITE;
+    tx[1] = addr;
+    for (uint8_t i = 0; i < n; i++)
+        tx[2 + i] = vals[i];
+    spi_xfer(tx, 0, 2 + n);
+}
+
+uint8_t mcp_read_reg(uint8_t addr) {
+    uint8_t tx[3] = { MCP_CMD_READ, addr, 0x00 };
+    uint8_t rx[3];
+    spi_xfer(tx, rx, sizeof(tx));
+    return rx[2];
+}
+
+void mcp_bit_modify(uint8_t addr, uint8_t mask, uint8_t data) {
+    uint8_t tx[4] = { MCP_CMD_BITMOD, addr, mask, data };
+    spi_xfer(tx, 0, sizeof(tx));
+}
+
+bool mcp_set_mode(uint8_t mode) {
+    mcp_bit_modify(MCP_CANCTRL, MCP_MODE_MASK, mode);
+
+    for (int i = 0; i < 100; i++) {
+        if ((mcp_read_reg(MCP_CANSTAT) & MCP_MODE_MASK) == mode)
+            return true;
+        timer_delay_us(10);
+    }
+    return false;
 }
 
 static void mcp_reset(void) {
-    spi_cs_low();
-    spi_transfer(MCP_CMD_RESET);
-    spi_cs_high();
+    uint8_t cmd = MCP_CMD_RESET;
+    spi_xfer(&cmd, 0, 1);
     timer_delay_us(1000);
 }
 
-static void mcp_set_bit_timing(mcp_xtal_t xtal, mcp_bitrate_t br) {
-    uint8_t cnf1 = 0, cnf2 = 0, cnf3 = 0;
-
-    switch (xtal) {
-    case MCP_XTAL_16MHZ:
-        switch (br) {
-        case MCP_BITRATE_125K:
-            // 16MHz, 125k: BRP=7, PropSeg=1, PS1=3, PS2=2
-            cnf1 = 0x07;
-            cnf2 = 0x93;
-            cnf3 = 0x01;
-            break;
-        case MCP_BITRATE_250K:
-            // 16MHz, 250k: BRP=3
-            cnf1 = 0x03;
-            cnf2 = 0x93;
-            cnf3 = 0x01;
-            break;
-        case MCP_BITRATE_500K:
-            // 16MHz, 500k: BRP=1
-            cnf1 = 0x01;
-            cnf2 = 0x93;
-            cnf3 = 0x01;
-            break;
-        case MCP_BITRATE_1000K:
-            // 16MHz, 1M: BRP=0
-            cnf1 = 0x00;
-            cnf2 = 0x92; // shorter TSEG1
-            cnf3 = 0x00; // PS2=1
-            break;
-        }
-        break;
-
-    case MCP_XTAL_8MHZ:
-        switch (br) {
-        case MCP_BITRATE_125K:
-            // 8MHz, 125k: BRP=3
-            cnf1 = 0x03;
-            cnf2 = 0x93;
-            cnf3 = 0x01;
-            break;
-        case MCP_BITRATE_250K:
-            // 8MHz, 250k: BRP=1
-            cnf1 = 0x01;
-            cnf2 = 0x93;
-            cnf3 = 0x01;
-            break;
-        case MCP_BITRATE_500K:
-            // 8MHz, 500k: BRP=0
-            cnf1 = 0x00;
-            cnf2 = 0x93;
-            cnf3 = 0x01;
-            break;
-        case MCP_BITRATE_1000K:
-            // 8MHz, 1M: BRP=0, fewer TQ
-            cnf1 = 0x00;
-            cnf2 = 0x82; // shorter PS1+PropSeg
-            cnf3 = 0x00; // PS2=1
-            break;
-        }
-        break;
-    }
+// Every rate uses 8 time quanta per bit: sync 1, PropSeg 2, PS1 3, PS2 2,
+// sampling at 75% with SJW 1. Only the prescaler changes between rates:
+// TQ = 2 x (BRP + 1) / Fosc.
+#define MCP_TQ_PER_BIT  8
+#define MCP_CNF2_8TQ    0x91    // BTLMODE, PHSEG1 = 3 TQ, PRSEG = 2 TQ
+#define MCP_CNF3_8TQ    0x01    // PHSEG2 = 2 TQ
+
+static const uint32_t bitrate_bps[MCP_NUM_BITRATES] = {
+    [MCP_BITRATE_125K]  = 125000,
+    [MCP_BITRATE_250K]  = 250000,
+    [MCP_BITRATE_500K]  = 500000,
+    [MCP_BITRATE_1000K] = 1000000,
+};
+
+// Needs config mode. False if the crystal cannot make the rate (1 Mbit/s
+// from 8 MHz would need 4 TQ per bit; the controller's minimum is 5).
+static bool mcp_set_bit_timing(mcp_xtal_t xtal, mcp_bitrate_t br) {
+    uint32_t fosc = xtal == MCP_XTAL_16MHZ ? 16000000 : 8000000;
+    uint32_t div = fosc / (2 * MCP_TQ_PER_BIT * bitrate_bps[br]);
+
+    if (div == 0)
+        return false;
 
-    mcp_write_reg(MCP_CNF1, cnf1);
-    mcp_write_reg(MCP_CNF2, cnf2);
-    mcp_write_reg(MCP_CNF3, cnf3);
+    mcp_write_reg(MCP_CNF1, (uint8_t)(div - 1));
+    mcp_write_reg(MCP_CNF2, MCP_CNF2_8TQ);
+    mcp_write_reg(MCP_CNF3, MCP_CNF3_8TQ);
+    return true;
 }
 
-bool mcp2515_init(mcp_xtal_t xtal, mcp_bitrate_t br) {
-    spi_init();
+// Settings from mcp2515_init(), reapplied by mcp_reinit()
+static mcp_xtal_t cfg_xtal;
+static mcp_bitrate_t cfg_br;
+static uint32_t cfg_flags;
+
+// Reset the chip and bring it up in normal or listen-only mode
+static bool mcp_configure(void) {
     mcp_reset();
 
     // Config mode
-    mcp_write_reg(MCP_CANCTRL, 0x80);
+    mcp_write_reg(MCP_CANCTRL, MCP_MODE_CONFIG);
     timer_delay_us(1000);
 
-    mcp_set_bit_timing(xtal, br);
-
-    // RX0: receive all
-    mcp_write_reg(MCP_RXB0CTRL, 0x60);
-    // RX0 interrupt
-    mcp_write_reg(MCP_CANINTE, 0x01);
+    if (!mcp_set_bit_timing(cfg_xtal, cfg_br)) {
+        uart_puts("MCP2515: bitrate not possible with this crystal\n");
+        return false;
+    }
 
-    // Normal mode
-    mcp_write_reg(MCP_CANCTRL, 0x00);
-    timer_delay_us(1000);
+    // RX0/RX1: receive all, RXB0 rolls over into RXB1 when full
+    mcp_write_reg(MCP_RXB0CTRL, MCP_RXM_ANY | MCP_RXB0_BUKT);
+    mcp_write_reg(MCP_RXB1CTRL, MCP_RXM_ANY);
+    // RX, TX-complete, error (EFLG change) and message-error interrupts
+    mcp_write_reg(MCP_CANINTE, MCP_INT_RX0 | MCP_INT_RX1 | MCP_INT_TX_ALL |
+                               MCP_INT_ERR | MCP_INT_MERR);
 
-    uint8_t stat = mcp_read_reg(MCP_CANSTAT);
-    if ((stat & 0xE0) != 0x00) {
-        uart_puts("MCP2515: failed to enter normal mode\n");
+    // Normal mode, or listen-only: receive without ever driving the bus
+    uint8_t mode = (cfg_flags & MCP2515_LISTEN_ONLY) ? MCP_MODE_LISTEN : MCP_MODE_NORMAL;
+    if (!mcp_set_mode(mode)) {
+        uart_puts("MCP2515: failed to leave config mode\n");
         return false;
     }
-
-    uart_puts("MCP2515: init OK\n");
     return true;
 }
 
+static void mcp_int_irq(uint32_t irq, void *ctx) {
+    mcp2515_isr();
+}
 
+bool mcp2515_init(mcp_xtal_t xtal, mcp_bitrate_t br, uint32_t flags) {
+    can_ring_init(&rx_ring);
+    spi_init();
+    spi_set_clock_hz(MCP_SPI_HZ);
+
+    cfg_xtal = xtal;
+    cfg_br = br;
+    cfg_flags = flags;
+    mcp_tx_init();
+    mcp_err_init();
 
-bool mcp2515_send(const can_frame_t *f) {
-    // Standard ID only for now
-    uint16_t sid = (uint16_t)f->id & 0x7FF;
+    // INT is open-drain active low: pull it up and catch its falling edge
+    gpio_set_input(MCP2515_INT_PIN);
+    gpio_set_pull(MCP2515_INT_PIN, GPIO_PULL_UP);
+    gpio_clear_event(MCP2515_INT_PIN);
+    gpio_enable_falling_edge(MCP2515_INT_PIN);
+    irq_register(IRQ_GPIO(0), mcp_int_irq, 0);
+    irq_enable(IRQ_GPIO(0));
 
-    spi_cs_low();
-    spi_transfer(MCP_CMD_WRITE);
-    spi_transfer(MCP_TXB0SIDH);
-    spi_transfer((sid >> 3) & 0xFF);
-    spi_transfer((sid & 0x07) << 5);
-    spi_transfer(0x00); // EID8
-    spi_transfer(0x00); // EID0
-    spi_transfer(f->dlc & 0x0F);
-    for (uint8_t i = 0; i < f->dlc; i++) {
-        spi_transfer(f->data[i]);
+    if (flags & MCP2515_AUTOBAUD) {
+        // Listen only until a rate locks: a wrong guess in normal mode
+        // would put error frames on the bus
+        mcp_reset();
+        mcp_autobaud_start(br);
+        uart_puts("MCP2515: init OK, detecting bitrate\n");
+        return true;
     }
-    spi_cs_high();
 
-    // Request to send TXB0
-    spi_cs_low();
-    spi_transfer(MCP_CMD_RTS_TXB0);
-    spi_cs_high();
+    if (!mcp_configure())
+        return false;
+
+    // INT may already be low (frames arrived before the edge detector
+    // was armed); drain once so the line goes high and edges start
+    mcp2515_isr();
 
+    uart_puts("MCP2515: init OK\n");
     return true;
 }
 
-bool mcp2515_recv(can_frame_t *f) {
-    // Check RX0IF
-    uint8_t intf = mcp_read_reg(MCP_CANINTF);
-    if (!(intf & 0x01))
+mcp_bitrate_t mcp2515_bitrate(void) {
+    return cfg_br;
+}
+
+bool mcp2515_bitrate_locked(void) {
+    return !mcp_autobaud_running();
+}
+
+bool mcp_listen_only(void) {
+    return (cfg_flags & MCP2515_LISTEN_ONLY) != 0;
+}
+
+bool mcp_try_bitrate(mcp_bitrate_t br) {
+    if (!mcp_set_mode(MCP_MODE_CONFIG))
+        return false;
+
+    cfg_br = br;
+    if (!mcp_set_bit_timing(cfg_xtal, br))
+        return false;
+
+    // The search polls CANINTF itself; INT stays high throughout
+    mcp_write_reg(MCP_RXB0CTRL, MCP_RXM_ANY | MCP_RXB0_BUKT);
+    mcp_write_reg(MCP_RXB1CTRL, MCP_RXM_ANY);
+    mcp_write_reg(MCP_CANINTE, 0);
+    mcp_write_reg(MCP_CANINTF, 0);
+    mcp_write_reg(MCP_EFLG, 0);
+
+    return mcp_set_mode(MCP_MODE_LISTEN);
+}
+
+bool mcp_bitrate_lock(mcp_bitrate_t br) {
+    cfg_br = br;
+    return mcp_reinit();
+}
+
+bool mcp_reinit(void) {
+    // Let a running drain finish; its SPI transfers would straddle the reset
+    if (rx_dma_running)
         return false;
 
-    spi_cs_low();
-    spi_transfer(MCP_CMD_READ);
-    spi_transfer(MCP_RXB0SIDH);
-    uint8_t sidh = spi_transfer(0x00);
-    uint8_t sidl = spi_transfer(0x00);
-    spi_transfer(0x00); // EID8
-    spi_transfer(0x00); // EID0
-    uint8_t dlc = spi_transfer(0x00);
-    dlc &= 0x0F;
-
-    uint16_t sid = ((uint16_t)sidh << 3) | (sidl >> 5);
-    f->id = sid;
+    if (!mcp_configure() || !mcp_filter_restore())
+        return false;
+
+    mcp_err_init();
+    mcp_tx_restart();
+    mcp2515_isr();
+    return true;
+}
+
+void mcp_encode_id(uint32_t id, uint8_t *out) {
+    if (id & CAN_EFF_FLAG) {
+        uint32_t eid = id & CAN_EFF_MASK;
+        out[0] = (uint8_t)(eid >> 21);
+        out[1] = (uint8_t)(((eid >> 18) & 0x07) << 5) | MCP_SIDL_IDE |
+                 (uint8_t)((eid >> 16) & 0x03);
+        out[2] = (uint8_t)(eid >> 8);
+        out[3] = (uint8_t)eid;
+    } else {
+        uint32_t sid = id & CAN_SFF_MASK;
+        out[0] = (uint8_t)(sid >> 3);
+        out[1] = (uint8_t)((sid & 0x07) << 5);
+        out[2] = 0x00;
+        out[3] = 0x00;
+    }
+}
+
+// Decode a READ RX BUFFER burst (raw[0] is the command slot)
+static void mcp_decode_rx(const uint8_t *raw, can_frame_t *f) {
+    uint8_t sidh = raw[1];
+    uint8_t sidl = raw[2];
+    uint8_t dlc = raw[5] & 0x0F;
+    if (dlc > 8)
+        dlc = 8;
+
+    uint32_t sid = ((uint32_t)sidh << 3) | (sidl >> 5);
+
+    if (sidl & MCP_SIDL_IDE) {
+        f->id = CAN_EFF_FLAG | (sid << 18) | ((uint32_t)(sidl & 0x03) << 16) |
+                ((uint32_t)raw[3] << 8) | raw[4];
+    } else {
+        f->id = sid;
+    }
     f->dlc = dlc;
     for (uint8_t i = 0; i < dlc; i++) {
-        f->data[i] = spi_transfer(0x00);
+        f->data[i] = raw[6 + i];
+    }
+}
+
+// One fixed-length burst per frame: READ RX BUFFER clears RXnIF itself
+// when CS rises, and reading past the DLC is harmless
+static void mcp_read_rx_buffer(uint8_t cmd, can_frame_t *f) {
+    uint8_t tx[MCP_RX_BURST] = { cmd };
+    uint8_t rx[MCP_RX_BURST];
+    spi_xfer(tx, rx, MCP_RX_BURST);
+    mcp_decode_rx(rx, f);
+}
+
+static void rxq_push(const can_frame_t *f) {
+    can_ring_push(&rx_ring, f, rx_stamp);
+}
+
+// ------------------------------------------------------------
+// DMA receive
+// ------------------------------------------------------------
+
+typedef struct {
+    mcp_rx_done_fn done;
+    void *ctx;
+} rx_async_t;
+
+static rx_async_t rx_async;
+
+static void rx_async_complete(const uint8_t *rx, uint32_t len, void *ctx) {
+    can_frame_t f;
+    mcp_decode_rx(rx, &f);
+    rx_async.done(&f, rx_async.ctx);
+}
+
+bool mcp2515_read_rx_async(uint8_t rxb, mcp_rx_done_fn done, void *ctx) {
+    uint8_t tx[MCP_RX_BURST] = { rxb ? MCP_CMD_READ_RXB1 : MCP_CMD_READ_RXB0 };
+
+    if (spi_busy())
+        return false;
+
+    rx_async.done = done;
+    rx_async.ctx = ctx;
+    return spi_xfer_async(tx, MCP_RX_BURST, rx_async_complete, 0);
+}
+
+// Flags other than RX from one CANINTF read: transmit completions, and
+// ERRIF/MERRF (handled by mcp2515_err.c). Errors are serviced on every
+// pass, so RX overflows and state changes during a long RX burst are
+// seen as they happen. Returns true if anything was serviced.
+static bool mcp_service_flags(uint8_t intf) {
+    bool serviced = false;
+
+    if (intf & MCP_INT_TX_ALL) {
+        mcp_tx_service(intf);
+        serviced = true;
     }
-    spi_cs_high();
 
-    // Clear RX0IF
-    mcp_bit_modify(MCP_CANINTF, 0x01, 0x00);
+    if (intf & (MCP_INT_ERR | MCP_INT_MERR)) {
+        mcp_err_service(intf);
+        serviced = true;
+    }
 
+    return serviced;
+}
+
+static void rx_dma_next(void);
+
+static void rx_dma_frame(const can_frame_t *f, void *ctx) {
+    rxq_push(f);
+    rx_dma_next();
+}
+
+// Fetch the buffers flagged by the last CANINTF read one DMA burst at a
+// time; once both are done, look again while INT is still asserted
+static void rx_dma_next(void) {
+    for (;;) {
+        if (!rx_dma_pending) {
+            if (gpio_read(MCP2515_INT_PIN))
+                break;
+            if (rx_restamp)
+                rx_stamp = timer_get_counter();
+            rx_restamp = true;
+            uint8_t intf = mcp_read_reg(MCP_CANINTF);
+            bool other = mcp_service_flags(intf);
+            rx_dma_pending = intf & (MCP_INT_RX0 | MCP_INT_RX1);
+            if (!rx_dma_pending) {
+                if (!other)
+                    break;
+                continue;
+            }
+        }
+
+        // With rollover RXB0 holds the older frame, so read it first
+        uint8_t rxb = (rx_dma_pending & MCP_INT_RX0) ? 0 : 1;
+        rx_dma_pending &= rxb ? ~MCP_INT_RX1 : ~MCP_INT_RX0;
+
+        if (mcp2515_read_rx_async(rxb, rx_dma_frame, 0))
+            return;
+
+        // SPI DMA taken by another transfer: fall back to a polled burst
+        can_frame_t f;
+        mcp_read_rx_buffer(rxb ? MCP_CMD_READ_RXB1 : MCP_CMD_READ_RXB0, &f);
+        rxq_push(&f);
+    }
+
+    rx_dma_running = false;
+}
+
+void mcp2515_isr(void) {
+    // Stamp first: everything below costs SPI time
+    uint64_t now = timer_get_counter();
+
+    gpio_clear_event(MCP2515_INT_PIN);
+
+    // The bitrate search owns the controller and polls it itself
+    if (mcp_autobaud_running())
+        return;
+
+    // A running chain re-reads CANINTF before it stops, so this edge
+    // is covered by it
+    if (rx_dma_running)
+        return;
+
+    // INT is level-triggered on the chip side: the chain keeps draining
+    // while it is asserted, or a frame that lands mid-read would never
+    // raise a new edge
+    rx_dma_running = true;
+    rx_dma_pending = 0;
+    rx_stamp = now;
+    rx_restamp = false;
+    rx_dma_next();
+}
+
+bool mcp2515_int_pending(void) {
+    return gpio_event_pending(MCP2515_INT_PIN);
+}
+
+bool mcp2515_recv(can_frame_t *f) {
+    can_rx_t rx;
+    if (!can_ring_pop(&rx_ring, &rx))
+        return false;
+
+    *f = rx.frame;
     return true;
 }
+
+struct can_ring *mcp2515_rx_ring(void) {
+    return &rx_ring;
+}
+
+uint32_t mcp2515_rx_dropped(void) {
+    return can_ring_dropped(&rx_ring);
+}
@@ -0,0 +1,120 @@
+#include "mcp2515.h"
+#include "mcp2515_regs.h"
+#include "uart.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Bitrate detection.
+//
+// Each rate in the mcp_bitrate_t table is tried in listen-only mode,
+// where the controller neither ACKs nor sends error frames, so a wrong
+// guess is invisible to the rest of the bus. At a wrong rate the frames
+// on the wire show up as MERRF (bit, stuff, form or CRC errors); at the
+// right one they land in RXB0/RXB1 cleanly. The search starts with the
+// rate passed to mcp2515_init(), so a unit already on the right bus
+// locks on its first frames, and a full sweep of the table takes at most
+// MCP_NUM_BITRATES x WINDOW_US. On a quiet bus it keeps sweeping from
+// mcp2515_poll() until traffic appears.
+
+#define WINDOW_US       200000u   // per candidate: a sweep stays under 1 s
+#define LOCK_FRAMES     2         // clean frames, no errors: lock at once
+#define REJECT_ERRORS   4         // errors, no frames: next candidate at once
+#define POLL_US         500       // CANINTF reads; two RX buffers cover the gap
+
+static const char *const rate_name[MCP_NUM_BITRATES] = {
+    [MCP_BITRATE_125K]  = "125",
+    [MCP_BITRATE_250K]  = "250",
+    [MCP_BITRATE_500K]  = "500",
+    [MCP_BITRATE_1000K] = "1000",
+};
+
+static bool running;
+static mcp_bitrate_t cand;
+static uint64_t window_end;       // 0: candidate not programmed yet
+static uint64_t next_poll;
+static uint32_t frames, errors;
+static uint32_t tried;            // candidates tried so far
+
+void mcp_autobaud_start(mcp_bitrate_t first) {
+    running = true;
+    cand = first;
+    window_end = 0;
+    tried = 0;
+}
+
+bool mcp_autobaud_running(void) {
+    return running;
+}
+
+static void next_candidate(void) {
+    cand = (mcp_bitrate_t)((cand + 1) % MCP_NUM_BITRATES);
+    window_end = 0;
+
+    if (++tried == MCP_NUM_BITRATES)
+        uart_puts("MCP2515: no bitrate locked yet, still listening\n");
+}
+
+static void lock(void) {
+    running = false;
+
+    if (!mcp_bitrate_lock(cand)) {
+        uart_puts("MCP2515: bus start failed, searching again\n");
+        mcp_autobaud_start(cand);
+        return;
+    }
+
+    uart_puts("MCP2515: bitrate locked at ");
+    uart_puts(rate_name[cand]);
+    uart_puts(" kbit/s\n");
+}
+
+bool mcp_autobaud_poll(uint64_t now) {
+    if (!running)
+        return false;
+
+    if (!window_end) {
+        // Skips rates the crystal cannot make
+        if (mcp_try_bitrate(cand)) {
+            frames = 0;
+            errors = 0;
+            window_end = now + WINDOW_US;
+            next_poll = now + POLL_US;
+        } else {
+            next_candidate();
+        }
+        return true;
+    }
+
+    if (now < next_poll)
+        return true;
+    next_poll = now + POLL_US;
+
+    // Frames are only counted: clearing RXnIF releases the buffers. MERRF
+    // is one flag however many errors it stands for.
+    uint8_t intf = mcp_read_reg(MCP_CANINTF) & (MCP_INT_RX0 | MCP_INT_RX1 | MCP_INT_MERR);
+    if (intf) {
+        frames += ((intf & MCP_INT_RX0) != 0) + ((intf & MCP_INT_RX1) != 0);
+        errors += (intf & MCP_INT_MERR) != 0;
+        mcp_bit_modify(MCP_CANINTF, intf, 0);
+    }
+
+    if (frames >= LOCK_FRAMES && errors == 0) {
+        lock();
+        return running;
+    }
+
+    if (frames == 0 && errors >= REJECT_ERRORS) {
+        next_candidate();
+        return true;
+    }
+
+    if (now >= window_end) {
+        // A noisy bus at the right rate still delivers mostly good frames
+        if (frames > errors) {
+            lock();
+            return running;
+        }
+        next_candidate();
+    }
+    return true;
+}
@@ -0,0 +1,129 @@
+#include "mcp2515.h"
+#include "mcp2515_regs.h"
+#include "irq.h"
+#include "timer.h"
+#include "uart.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Error management.
+//
+// ERRIF fires whenever EFLG changes: RX overflows are counted and cleared
+// here, and the TEC/REC-derived flags drive the active/passive/bus-off
+// state. The MCP2515 leaves bus-off by itself after 128 x 11 recessive
+// bits, but a controller that stays off (shorted bus, wrong bitrate) is
+// reset and reconfigured from mcp2515_poll(), with exponential back-off
+// between attempts so a dead bus costs little SPI time.
+
+#define BACKOFF_MIN_US    100000u     // first re-init 100 ms after bus-off
+#define BACKOFF_MAX_US    5000000u
+#define STABLE_US         10000000u   // error-active this long resets the back-off
+
+static mcp_err_stats_t est;
+static uint32_t backoff_us = BACKOFF_MIN_US;
+static uint64_t reinit_at;            // 0: no re-init scheduled
+static uint64_t active_since;
+
+void mcp_err_init(void) {
+    est.state = MCP_ERR_ACTIVE;
+    est.tec = 0;
+    est.rec = 0;
+    est.eflg = 0;
+    reinit_at = 0;
+    active_since = timer_get_counter();
+}
+
+static mcp_err_state_t state_from_eflg(uint8_t eflg) {
+    if (eflg & MCP_EFLG_TXBO)
+        return MCP_ERR_BUS_OFF;
+    if (eflg & (MCP_EFLG_TXEP | MCP_EFLG_RXEP))
+        return MCP_ERR_PASSIVE;
+    return MCP_ERR_ACTIVE;
+}
+
+static void set_state(mcp_err_state_t s) {
+    if (s == est.state)
+        return;
+
+    est.state = s;
+    switch (s) {
+    case MCP_ERR_ACTIVE:
+        est.to_active++;
+        active_since = timer_get_counter();
+        reinit_at = 0;              // recovered by itself
+        break;
+    case MCP_ERR_PASSIVE:
+        est.to_passive++;
+        reinit_at = 0;
+        break;
+    case MCP_ERR_BUS_OFF:
+        est.to_bus_off++;
+        reinit_at = timer_get_counter() + backoff_us;
+        break;
+    }
+}
+
+void mcp_err_service(uint8_t intf) {
+    if (intf & MCP_INT_MERR) {
+        est.msg_errors++;
+        mcp_tx_error_service();
+    }
+
+    if (intf & MCP_INT_ERR) {
+        uint8_t eflg = mcp_read_reg(MCP_EFLG);
+        est.eflg = eflg;
+
+        // The buffer was full when a frame arrived: that frame is gone
+        if (eflg & MCP_EFLG_RX0OVR)
+            est.rx0_overflow++;
+        if (eflg & MCP_EFLG_RX1OVR)
+            est.rx1_overflow++;
+        if (eflg & (MCP_EFLG_RX0OVR | MCP_EFLG_RX1OVR))
+            mcp_bit_modify(MCP_EFLG, MCP_EFLG_RX0OVR | MCP_EFLG_RX1OVR, 0);
+
+        est.tec = mcp_read_reg(MCP_TEC);
+        est.rec = mcp_read_reg(MCP_REC);
+        set_state(state_from_eflg(eflg));
+    }
+
+    mcp_bit_modify(MCP_CANINTF, intf & (MCP_INT_ERR | MCP_INT_MERR), 0);
+}
+
+static void poll(uint64_t now) {
+    if (mcp_autobaud_poll(now))
+        return;
+
+    if (est.state == MCP_ERR_ACTIVE && backoff_us != BACKOFF_MIN_US &&
+        now - active_since >= STABLE_US)
+        backoff_us = BACKOFF_MIN_US;
+
+    if (!reinit_at || now < reinit_at)
+        return;
+
+    est.reinits++;
+    uart_puts("MCP2515: bus-off, re-initialising\n");
+
+    // Success restarts in error-active with nothing scheduled
+    if (!mcp_reinit())
+        reinit_at = now + backoff_us;
+
+    // Each consecutive attempt waits twice as long
+    backoff_us = backoff_us * 2 > BACKOFF_MAX_US ? BACKOFF_MAX_US : backoff_us * 2;
+}
+
+void mcp2515_poll(uint64_t now) {
+    // The search and the re-init use polled SPI, which must not meet a
+    // DMA drain started by the INT service halfway
+    uint64_t daif = irq_save();
+    poll(now);
+    irq_restore(daif);
+}
+
+void mcp2515_err_stats(mcp_err_stats_t *out) {
+    *out = est;
+    out->rx_ring_full = mcp2515_rx_dropped();
+}
+
+uint32_t mcp2515_frames_lost(void) {
+    return est.rx0_overflow + est.rx1_overflow + mcp2515_rx_dropped();
+}
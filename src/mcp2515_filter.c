@@ -0,0 +1,238 @@
+#include "mcp2515.h"
+#include "mcp2515_regs.h"
+#include "irq.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Acceptance filter planning.
+//
+// IDs are compared as 29-bit keys laid out like the MCP2515 registers:
+// an 11-bit ID occupies the SID bits (28..18), a 29-bit ID all of them.
+// Each RX buffer has one mask and a few filters; a frame is accepted when
+// (key & mask) equals some (filter & mask) of the same frame type. We pick
+// a split of the wanted IDs between RXB0 (2 filters) and RXB1 (4 filters)
+// and, per buffer, the mask that lets the fewest unwanted keys through.
+
+#define FILTER_MAX_IDS  64
+#define KEY_SID_MASK    0x1FFC0000u   // SID bits of a key
+
+// Last list passed to mcp2515_set_filters(), reprogrammed after a re-init
+static uint32_t cur_ids[FILTER_MAX_IDS];
+static uint32_t cur_n = 0;
+
+typedef struct {
+    uint32_t mask;
+    uint32_t keys[4];
+    uint8_t ext[4];
+    uint32_t nfilt;
+} buf_plan_t;
+
+static uint32_t id_key(uint32_t id) {
+    if (id & CAN_EFF_FLAG)
+        return id & CAN_EFF_MASK;
+    return (id & CAN_SFF_MASK) << 18;
+}
+
+static uint32_t popcount32(uint32_t v) {
+    uint32_t n = 0;
+    while (v) {
+        v &= v - 1;
+        n++;
+    }
+    return n;
+}
+
+// Distinct (key & mask, type) classes among ids; stops counting past limit
+static uint32_t count_classes(const uint32_t *ids, uint32_t n, uint32_t mask,
+                              uint32_t limit, buf_plan_t *out) {
+    uint32_t cls_key[FILTER_MAX_IDS];
+    uint8_t cls_ext[FILTER_MAX_IDS];
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t k = id_key(ids[i]) & mask;
+        uint8_t e = (ids[i] & CAN_EFF_FLAG) ? 1 : 0;
+        uint32_t j;
+
+        for (j = 0; j < count; j++) {
+            if (cls_key[j] == k && cls_ext[j] == e)
+                break;
+        }
+
+        if (j == count) {
+            if (count == limit)
+                return limit + 1;
+            cls_key[count] = k;
+            cls_ext[count] = e;
+            count++;
+        }
+    }
+
+    if (out) {
+        out->mask = mask;
+        out->nfilt = count;
+        for (uint32_t j = 0; j < count; j++) {
+            out->keys[j] = cls_key[j];
+            out->ext[j] = cls_ext[j];
+        }
+    }
+
+    return count;
+}
+
+// Plan one buffer with k filters; returns how many distinct keys it accepts
+static uint64_t plan_buffer(const uint32_t *ids, uint32_t n, uint32_t k, buf_plan_t *p) {
+    p->nfilt = 0;
+    if (n == 0)
+        return 0;
+
+    // For standard frames the mask's EID bits filter data bytes 0-1, so a
+    // buffer carrying any 11-bit ID may only compare SID bits
+    bool any_std = false;
+    for (uint32_t i = 0; i < n; i++) {
+        if (!(ids[i] & CAN_EFF_FLAG))
+            any_std = true;
+    }
+
+    uint32_t mask = any_std ? KEY_SID_MASK : CAN_EFF_MASK;
+
+    // Greedily drop the mask bit that merges the most classes until the
+    // classes fit in the filters
+    while (count_classes(ids, n, mask, k, 0) > k) {
+        uint32_t best_bit = 0, best_count = 0xFFFFFFFF;
+
+        for (uint32_t b = 0; b < 29; b++) {
+            if (!(mask & (1u << b)))
+                continue;
+            uint32_t c = count_classes(ids, n, mask & ~(1u << b), FILTER_MAX_IDS, 0);
+            if (c < best_count) {
+                best_count = c;
+                best_bit = b;
+            }
+        }
+
+        mask &= ~(1u << best_bit);
+    }
+
+    count_classes(ids, n, mask, k, p);
+
+    uint64_t accepted = 0;
+    for (uint32_t j = 0; j < p->nfilt; j++) {
+        uint32_t care = p->ext[j] ? popcount32(mask) : popcount32(mask & KEY_SID_MASK);
+        uint32_t width = p->ext[j] ? 29 : 11;
+        accepted += 1ull << (width - care);
+    }
+
+    return accepted;
+}
+
+static void write_key(uint8_t addr, uint32_t key, bool ext) {
+    uint8_t regs[4];
+    mcp_encode_id(ext ? (key | CAN_EFF_FLAG) : (key >> 18), regs);
+    mcp_write_regs(addr, regs, 4);
+}
+
+static void program_buffer(const buf_plan_t *p, uint8_t mask_addr,
+                           const uint8_t *filt_addr, uint32_t k) {
+    // Masks have no IDE bit: write the key bits as an extended ID
+    write_key(mask_addr, p->mask, true);
+
+    // Spare filter slots repeat the first one
+    for (uint32_t j = 0; j < k; j++) {
+        uint32_t s = j < p->nfilt ? j : 0;
+        write_key(filt_addr[j], p->keys[s], p->ext[s]);
+    }
+}
+
+static bool apply_plan(buf_plan_t *best0, buf_plan_t *best1, uint32_t n) {
+    static const uint8_t rxb0_filters[2] = { MCP_RXF0SIDH, MCP_RXF1SIDH };
+    static const uint8_t rxb1_filters[4] = { MCP_RXF2SIDH, MCP_RXF3SIDH,
+                                             MCP_RXF4SIDH, MCP_RXF5SIDH };
+
+    uint8_t prev_mode = mcp_read_reg(MCP_CANSTAT) & MCP_MODE_MASK;
+    if (!mcp_set_mode(MCP_MODE_CONFIG))
+        return false;
+
+    if (n == 0) {
+        mcp_write_reg(MCP_RXB0CTRL, MCP_RXM_ANY | MCP_RXB0_BUKT);
+        mcp_write_reg(MCP_RXB1CTRL, MCP_RXM_ANY);
+        return mcp_set_mode(prev_mode);
+    }
+
+    // A buffer with no IDs of its own mirrors the other one, so it accepts
+    // nothing the other would not
+    if (best0->nfilt == 0)
+        *best0 = *best1;
+    if (best1->nfilt == 0)
+        *best1 = *best0;
+
+    program_buffer(best0, MCP_RXM0SIDH, rxb0_filters, 2);
+    program_buffer(best1, MCP_RXM1SIDH, rxb1_filters, 4);
+
+    mcp_write_reg(MCP_RXB0CTRL, MCP_RXM_FILTER | MCP_RXB0_BUKT);
+    mcp_write_reg(MCP_RXB1CTRL, MCP_RXM_FILTER);
+
+    return mcp_set_mode(prev_mode);
+}
+
+bool mcp2515_set_filters(const uint32_t *ids, uint32_t n) {
+    uint32_t sorted[FILTER_MAX_IDS];
+
+    if (n > FILTER_MAX_IDS)
+        return false;
+
+    if (ids != cur_ids) {
+        for (uint32_t i = 0; i < n; i++)
+            cur_ids[i] = ids[i];
+        cur_n = n;
+    }
+
+    // Leaving listen-only to program filters mid-search could put error
+    // frames on the bus; the list is applied once the bitrate locks
+    if (mcp_autobaud_running())
+        return true;
+
+    // Sort by key so that neighbouring IDs (which share high bits) can be
+    // given to the same buffer
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t v = ids[i];
+        uint32_t j = i;
+        while (j > 0 && id_key(sorted[j - 1]) > id_key(v)) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+    }
+
+    buf_plan_t best0 = { 0 }, best1 = { 0 };
+    uint64_t best_cost = ~0ull;
+
+    // Try every contiguous split, with either end going to RXB0
+    for (uint32_t split = 0; n && split <= n; split++) {
+        for (int low_to_rxb0 = 0; low_to_rxb0 < 2; low_to_rxb0++) {
+            const uint32_t *g0 = low_to_rxb0 ? sorted : sorted + split;
+            uint32_t n0 = low_to_rxb0 ? split : n - split;
+            const uint32_t *g1 = low_to_rxb0 ? sorted + split : sorted;
+            uint32_t n1 = n - n0;
+
+            buf_plan_t p0, p1;
+            uint64_t cost = plan_buffer(g0, n0, 2, &p0) + plan_buffer(g1, n1, 4, &p1);
+
+            if (cost < best_cost) {
+                best_cost = cost;
+                best0 = p0;
+                best1 = p1;
+            }
+        }
+    }
+
+    // Polled SPI: the INT service's DMA must stay off the bus meanwhile
+    uint64_t daif = irq_save();
+    bool ok = apply_plan(&best0, &best1, n);
+    irq_restore(daif);
+    return ok;
+}
+
+bool mcp_filter_restore(void) {
+    return mcp2515_set_filters(cur_ids, cur_n);
+}
@@ -0,0 +1,257 @@
+#include "mcp2515.h"
+#include "mcp2515_regs.h"
+#include "spi.h"
+#include "irq.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Transmit path: a software priority queue feeding TXB0-TXB2.
+//
+// mcp2515_send() only queues. Whenever a hardware buffer is free the
+// highest-priority queued frame is loaded into it, and the TXnIF
+// completions (serviced from the INT handler) refill buffers as they
+// empty, so the caller never waits for the bus.
+
+#define NUM_TXB 3
+
+typedef struct {
+    uint64_t prio;      // arbitration key << 32 | sequence, lower goes first
+    can_frame_t frame;
+} tx_entry_t;
+
+static tx_entry_t heap[MCP2515_TXQ_SIZE];
+static uint32_t heap_len = 0;
+static uint32_t tx_seq = 0;
+
+static bool txb_busy[NUM_TXB];
+static tx_entry_t txb_entry[NUM_TXB];     // what each busy buffer holds
+
+static bool refilling;          // refill() is running
+static bool refill_again;       // a nested refill() asked for another pass
+
+static mcp_tx_stats_t stats;
+
+// The queue is shared with the INT service: keep IRQs off while touching
+// it. Both run on the CAN core only. refill() loads the TX buffers with
+// polled SPI transfers, and SPI0 has no lock against the DMA reads the
+// INT service starts, so another core cannot safely send.
+static inline uint64_t tx_lock(void) {
+    return irq_save();
+}
+
+static inline void tx_unlock(uint64_t daif) {
+    irq_restore(daif);
+}
+
+// Lower value wins arbitration: base ID first, then a standard frame beats
+// an extended one with the same base ID, then the extended bits
+static uint32_t arb_key(uint32_t id) {
+    if (id & CAN_EFF_FLAG) {
+        uint32_t eid = id & CAN_EFF_MASK;
+        return ((eid >> 18) << 19) | (1u << 18) | (eid & 0x3FFFF);
+    }
+    return (id & CAN_SFF_MASK) << 19;
+}
+
+static void heap_push(const tx_entry_t *e) {
+    uint32_t i = heap_len++;
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (heap[parent].prio <= e->prio)
+            break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = *e;
+}
+
+static void heap_pop(tx_entry_t *out) {
+    *out = heap[0];
+    tx_entry_t last = heap[--heap_len];
+    uint32_t i = 0;
+
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+        if (child >= heap_len)
+            break;
+        if (child + 1 < heap_len && heap[child + 1].prio < heap[child].prio)
+            child++;
+        if (last.prio <= heap[child].prio)
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+}
+
+// TXP 3 goes first: rank the pending buffers so the lowest key gets 3
+static void rank_buffers(void) {
+    for (int n = 0; n < NUM_TXB; n++) {
+        if (!txb_busy[n])
+            continue;
+
+        uint8_t ahead = 0;
+        for (int m = 0; m < NUM_TXB; m++) {
+            if (m != n && txb_busy[m] && txb_entry[m].prio < txb_entry[n].prio)
+                ahead++;
+        }
+        mcp_bit_modify(MCP_TXBCTRL(n), MCP_TXB_TXP_MASK, 3 - ahead);
+    }
+}
+
+static void load_buffer(int n, const tx_entry_t *e) {
+    uint8_t dlc = e->frame.dlc > 8 ? 8 : e->frame.dlc;
+    uint8_t tx[1 + 5 + 8];
+
+    // LOAD TX BUFFER: ID, DLC and data in one burst
+    tx[0] = MCP_CMD_LOAD_TX(n);
+    mcp_encode_id(e->frame.id, &tx[1]);
+    tx[5] = dlc;
+    for (uint8_t i = 0; i < dlc; i++)
+        tx[6 + i] = e->frame.data[i];
+
+    // Claim the buffer first: the transfer may run the INT service
+    txb_busy[n] = true;
+    txb_entry[n] = *e;
+    spi_xfer(tx, 0, 6 + dlc);
+}
+
+// Move queued frames into free buffers (caller holds the lock).
+//
+// The lock only masks IRQs. A polled spi_xfer() first waits out a DMA
+// transfer in flight by running its completion, which continues the RX
+// drain and can service TX completions, landing here again. The nested
+// call leaves the buffers alone and has this one make another pass.
+static void refill(void) {
+    if (refilling) {
+        refill_again = true;
+        return;
+    }
+    refilling = true;
+
+    do {
+        uint8_t rts = 0x80;     // RTS with one bit per buffer to start
+
+        refill_again = false;
+        for (int n = 0; n < NUM_TXB && heap_len; n++) {
+            if (txb_busy[n])
+                continue;
+
+            tx_entry_t e;
+            heap_pop(&e);
+            load_buffer(n, &e);
+            rts |= MCP_CMD_RTS(n);
+        }
+
+        if (rts != 0x80) {
+            rank_buffers();
+            spi_xfer(&rts, 0, 1);
+        }
+    } while (refill_again);
+
+    refilling = false;
+}
+
+void mcp_tx_init(void) {
+    uint64_t daif = tx_lock();
+    heap_len = 0;
+    for (int n = 0; n < NUM_TXB; n++)
+        txb_busy[n] = false;
+    tx_unlock(daif);
+}
+
+// After a controller re-init the TX buffers are empty: put the frames they
+// held back in the queue (they keep their original order) and reload
+void mcp_tx_restart(void) {
+    uint64_t daif = tx_lock();
+
+    for (int n = 0; n < NUM_TXB; n++) {
+        if (!txb_busy[n])
+            continue;
+
+        txb_busy[n] = false;
+        if (heap_len < MCP2515_TXQ_SIZE)
+            heap_push(&txb_entry[n]);
+        else
+            stats.dropped++;
+    }
+    refill();
+
+    tx_unlock(daif);
+}
+
+bool mcp2515_send(const can_frame_t *f) {
+    if (mcp_listen_only())
+        return false;
+
+    uint64_t daif = tx_lock();
+
+    if (heap_len >= MCP2515_TXQ_SIZE) {
+        stats.dropped++;
+        tx_unlock(daif);
+        return false;
+    }
+
+    tx_entry_t e;
+    e.prio = ((uint64_t)arb_key(f->id) << 32) | tx_seq++;
+    e.frame = *f;
+    heap_push(&e);
+    stats.queued++;
+
+    refill();
+
+    tx_unlock(daif);
+    return true;
+}
+
+void mcp_tx_service(uint8_t intf) {
+    uint64_t daif = tx_lock();
+    uint8_t done = 0;
+
+    for (int n = 0; n < NUM_TXB; n++) {
+        if (!(intf & MCP_INT_TX(n)))
+            continue;
+
+        // MLOA/TXERR stay set from earlier attempts until the next TXREQ
+        uint8_t ctrl = mcp_read_reg(MCP_TXBCTRL(n));
+        if (ctrl & MCP_TXB_MLOA)
+            stats.arb_lost++;
+
+        stats.sent++;
+        txb_busy[n] = false;
+        done |= MCP_INT_TX(n);
+    }
+
+    mcp_bit_modify(MCP_CANINTF, done, 0);
+    refill();
+
+    tx_unlock(daif);
+}
+
+void mcp_tx_error_service(void) {
+    uint64_t daif = tx_lock();
+
+    for (int n = 0; n < NUM_TXB; n++) {
+        if (txb_busy[n] && (mcp_read_reg(MCP_TXBCTRL(n)) & MCP_TXB_TXERR))
+            stats.errors++;
+    }
+
+    tx_unlock(daif);
+}
+
+uint32_t mcp2515_tx_pending(void) {
+    uint64_t daif = tx_lock();
+    uint32_t n = heap_len;
+    for (int b = 0; b < NUM_TXB; b++) {
+        if (txb_busy[b])
+            n++;
+    }
+    tx_unlock(daif);
+    return n;
+}
+
+void mcp2515_tx_stats(mcp_tx_stats_t *out) {
+    uint64_t daif = tx_lock();
+    *out = stats;
+    tx_unlock(daif);
+}
@@ -0,0 +1,153 @@
+#include "mmu.h"
+#include "peripherals.h"
+#include <stdint.h>
+#include <stddef.h>
+
+// 4 KB granule, 32-bit VA (T0SZ = 32): lookup starts at level 1, each
+// L1 entry covers 1 GB and each L2 block 2 MB
+
+#define BLOCK_SIZE      0x200000UL
+#define L2_ENTRIES      512
+
+#define DESC_INVALID    0x0UL
+#define DESC_BLOCK      0x1UL
+#define DESC_TABLE      0x3UL
+#define DESC_ATTR(i)    ((uint64_t)(i) << 2)
+#define DESC_SH_INNER   (3UL << 8)
+#define DESC_AF         (1UL << 10)
+#define DESC_PXN        (1UL << 53)
+#define DESC_UXN        (1UL << 54)
+
+#define MAIR_VALUE      ((0xFFUL << (8 * MMU_NORMAL)) |     \
+                         (0x04UL << (8 * MMU_DEVICE)) |     \
+                         (0x44UL << (8 * MMU_NORMAL_NC)))
+
+#define TCR_T0SZ        (32UL << 0)
+#define TCR_IRGN0_WBWA  (1UL << 8)
+#define TCR_ORGN0_WBWA  (1UL << 10)
+#define TCR_SH0_INNER   (3UL << 12)
+#define TCR_TG0_4K      (0UL << 14)
+#define TCR_EPD1        (1UL << 23)   // no TTBR1 walks
+#define TCR_VALUE       (TCR_T0SZ | TCR_IRGN0_WBWA | TCR_ORGN0_WBWA | \
+                         TCR_SH0_INNER | TCR_TG0_4K | TCR_EPD1)
+
+#define SCTLR_RES1      0x30D00800UL
+#define SCTLR_M         (1UL << 0)
+#define SCTLR_C         (1UL << 2)
+#define SCTLR_I         (1UL << 12)
+
+static uint64_t l1_table[L2_ENTRIES] __attribute__((aligned(4096)));
+static uint64_t l2_low[L2_ENTRIES] __attribute__((aligned(4096)));   // 0x00000000 - 0x3FFFFFFF
+static uint64_t l2_high[L2_ENTRIES] __attribute__((aligned(4096)));  // 0x40000000 - 0x7FFFFFFF
+
+static uint64_t block_desc(uintptr_t pa, mmu_mem_t type) {
+    uint64_t d = (pa & ~(BLOCK_SIZE - 1)) | DESC_BLOCK | DESC_AF | DESC_ATTR(type);
+
+    if (type == MMU_DEVICE)
+        d |= DESC_PXN | DESC_UXN;   // never fetch instructions from MMIO
+    else
+        d |= DESC_SH_INNER;
+
+    return d;
+}
+
+static void tlb_flush(void) {
+    __asm__ volatile(
+        "dsb ishst\n"
+        "tlbi vmalle1is\n"
+        "dsb ish\n"
+        "isb\n" ::: "memory");
+}
+
+void mmu_init(void) {
+    // RAM below the peripheral window is normal cacheable memory
+    for (uintptr_t i = 0; i < L2_ENTRIES; i++) {
+        uintptr_t pa = i * BLOCK_SIZE;
+        l2_low[i] = block_desc(pa, pa >= PERIPH_BASE ? MMU_DEVICE : MMU_NORMAL);
+    }
+
+    // ARM-local peripherals (0x40000000) are the only thing above 1 GB
+    for (uintptr_t i = 0; i < L2_ENTRIES; i++)
+        l2_high[i] = DESC_INVALID;
+    l2_high[0] = block_desc(LOCAL_PERIPH_BASE, MMU_DEVICE);
+
+    for (int i = 0; i < L2_ENTRIES; i++)
+        l1_table[i] = DESC_INVALID;
+    l1_table[0] = (uintptr_t)l2_low | DESC_TABLE;
+    l1_table[1] = (uintptr_t)l2_high | DESC_TABLE;
+
+    mmu_enable();
+}
+
+void mmu_enable(void) {
+    uint64_t sctlr;
+
+    __asm__ volatile(
+        "dsb sy\n"
+        "msr mair_el1, %0\n"
+        "msr tcr_el1, %1\n"
+        "msr ttbr0_el1, %2\n"
+        "isb\n"
+        "tlbi vmalle1\n"
+        "ic iallu\n"
+        "dsb nsh\n"
+        "isb\n"
+        :: "r"(MAIR_VALUE), "r"(TCR_VALUE), "r"((uintptr_t)l1_table)
+        : "memory");
+
+    __asm__ volatile("mrs %0, sctlr_el1" : "=r"(sctlr));
+    sctlr |= SCTLR_RES1 | SCTLR_M | SCTLR_C | SCTLR_I;
+    __asm__ volatile(
+        "msr sctlr_el1, %0\n"
+        "isb\n" :: "r"(sctlr) : "memory");
+}
+
+// Break-before-make per block: a live descriptor is never swapped for one
+// with different attributes while a TLB may still hold the old one. DC by
+// VA needs a valid mapping, so the block is cleaned and invalidated before
+// the break and again once the new type is in place, which also drops any
+// line fetched speculatively in between.
+void mmu_map_region(uintptr_t base, size_t size, mmu_mem_t type) {
+    uintptr_t start = base & ~(BLOCK_SIZE - 1);
+    uintptr_t end = base + size;
+
+    for (uintptr_t pa = start; pa < end; pa += BLOCK_SIZE) {
+        if (pa >= PERIPH_BASE)
+            break;  // the peripheral window always stays device memory
+
+        uint64_t desc = block_desc(pa, type);
+        if (l2_low[pa / BLOCK_SIZE] == desc)
+            continue;
+
+        dcache_clean_invalidate_range((void *)pa, BLOCK_SIZE);
+        l2_low[pa / BLOCK_SIZE] = DESC_INVALID;
+        tlb_flush();
+        l2_low[pa / BLOCK_SIZE] = desc;
+        tlb_flush();
+        dcache_clean_invalidate_range((void *)pa, BLOCK_SIZE);
+    }
+}
+
+// ------------------------------------------------------------
+// Cache maintenance
+// ------------------------------------------------------------
+
+static inline uintptr_t dcache_line_size(void) {
+    uint64_t ctr;
+    __asm__ volatile("mrs %0, ctr_el0" : "=r"(ctr));
+    return 4UL << ((ctr >> 16) & 0xF);   // DminLine is log2(words)
+}
+
+#define DCACHE_OP(name, insn)                                               \
+void name(const volatile void *addr, size_t size) {                        \
+    uintptr_t line = dcache_line_size();                                    \
+    uintptr_t p = (uintptr_t)addr & ~(line - 1);                            \
+    uintptr_t end = (uintptr_t)addr + size;                                 \
+    for (; p < end; p += line)                                              \
+        __asm__ volatile("dc " insn ", %0" :: "r"(p) : "memory");           \
+    __asm__ volatile("dsb sy" ::: "memory");                                \
+}
+
+DCACHE_OP(dcache_clean_range, "cvac")
+DCACHE_OP(dcache_invalidate_range, "ivac")
+DCACHE_OP(dcache_clean_invalidate_range, "civac")
@@ -0,0 +1,70 @@
+#include "smp.h"
+#include "mmu.h"
+#include "sync.h"
+#include "timer.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// The firmware's armstub parks each secondary core in a WFE loop on a
+// 64-bit release address at 0xD8 + 8 * core (0xE0, 0xE8, 0xF0). It
+// reads that word with its MMU off, so the write has to reach RAM, and
+// the SEV wakes it to look.
+#define SPIN_TABLE_BASE   0xD8
+#define START_TIMEOUT_US  100000
+
+extern char _secondary_start[];
+
+static struct {
+    smp_entry_fn fn;
+    void *ctx;
+} entry[SMP_NUM_CORES];
+
+// Check-in word per core: the released core and a timed-out
+// smp_start_core() race to move it out of CORE_PARKED
+#define CORE_PARKED     0
+#define CORE_ONLINE     1
+#define CORE_ABANDONED  2
+
+static uint32_t state[SMP_NUM_CORES];
+
+uint32_t smp_core_id(void) {
+    uint64_t mpidr;
+    __asm__ volatile("mrs %0, mpidr_el1" : "=r"(mpidr));
+    return (uint32_t)(mpidr & 3);
+}
+
+bool smp_start_core(uint32_t core, smp_entry_fn fn, void *ctx) {
+    if (core == 0 || core >= SMP_NUM_CORES ||
+        sync_load_acq(&state[core]) != CORE_PARKED)
+        return false;
+
+    // Read by the new core once its MMU is on and it is cache-coherent
+    entry[core].fn = fn;
+    entry[core].ctx = ctx;
+
+    volatile uint64_t *release = (volatile uint64_t *)(uintptr_t)(SPIN_TABLE_BASE + 8 * core);
+    *release = (uintptr_t)_secondary_start;
+    dcache_clean_range(release, sizeof(*release));
+    sync_sev();
+
+    uint64_t start = timer_get_counter();
+    while (timer_get_counter() - start < START_TIMEOUT_US) {
+        if (sync_load_acq(&state[core]) == CORE_ONLINE)
+            return true;
+    }
+
+    // Too late: a core that turns up after this parks instead of running
+    // work the caller is about to do elsewhere
+    uint32_t parked = CORE_PARKED;
+    return !sync_cas(&state[core], &parked, CORE_ABANDONED);
+}
+
+void smp_secondary_main(uint32_t core) {
+    uint32_t parked = CORE_PARKED;
+
+    if (sync_cas(&state[core], &parked, CORE_ONLINE))
+        entry[core].fn(entry[core].ctx);
+
+    for (;;)
+        sync_wfe();
+}
@@ -1,13 +1,20 @@
 #include "peripherals.h"
 #include "gpio.h"
 #include "spi.h"
+#include "dma.h"
+#include "mmu.h"
 
 #define SPI0_CS    (SPI0_BASE + 0x00)
 #define SPI0_FIFO  (SPI0_BASE + 0x04)
 #define SPI0_CLK   (SPI0_BASE + 0x08)
 
-#define SPI0_CS_TA   (1 << 7)
 #define SPI0_CS_CLEAR (3 << 4)
+#define SPI0_CS_TA    (1 << 7)
+#define SPI0_CS_DMAEN (1 << 8)
+#define SPI0_CS_ADCS  (1 << 11)
+#define SPI0_CS_DONE  (1 << 16)
+#define SPI0_CS_RXD   (1 << 17)
+#define SPI0_CS_TXD   (1 << 18)
 
 void spi_init(void) {
     // GPIO7-11 to ALT0 for SPI0
@@ -19,44 +26,160 @@ void spi_init(void) {
 
     // Clear FIFOs, set mode 0, use CS0
     mmio_write(SPI0_CS, SPI0_CS_CLEAR);
-    // Clock divider: 250MHz / 64 ≈ 3.9MHz
+    // Clock divider: 250MHz / 64 ≈ 3.9MHz until a device asks for more
     mmio_write(SPI0_CLK, 64);
+
+    dma_init();
 }
 
-static void spi_begin(void) {
-    uint32_t cs = mmio_read(SPI0_CS);
-    cs |= SPI0_CS_TA;
-    mmio_write(SPI0_CS, cs);
+void spi_set_clock_hz(uint32_t hz) {
+    uint64_t div;
+
+    if (hz == 0) {
+        mmio_write(SPI0_CLK, 0);    // 0 = slowest (/65536)
+        return;
+    }
+
+    div = ((uint64_t)SPI_CORE_CLK_HZ + hz - 1) / hz;
+    div = (div + 1) & ~1ull;        // CDIV must be even
+    if (div < 2)
+        div = 2;
+    if (div > 65534)
+        div = 0;                    // 0 = slowest (/65536)
+    mmio_write(SPI0_CLK, (uint32_t)div);
 }
 
-static void spi_end(void) {
-    uint32_t cs = mmio_read(SPI0_CS);
-    cs &= ~SPI0_CS_TA;
-    mmio_write(SPI0_CS, cs);
+static void spi_wait_idle(void);
+
+// Hardware CS0 follows TA, so a transaction is simply TA held high.
+// FIFOs are cleared once per transaction, not once per byte.
+void spi_cs_low(void) {
+    spi_wait_idle();
+    mmio_write(SPI0_CS, SPI0_CS_CLEAR | SPI0_CS_TA);
 }
 
-uint8_t spi_transfer(uint8_t v) {
-    spi_begin();
-    // Clear FIFOs
-    mmio_write(SPI0_CS, mmio_read(SPI0_CS) | SPI0_CS_CLEAR);
+void spi_cs_high(void) {
+    while (!(mmio_read(SPI0_CS) & SPI0_CS_DONE)) { }
+    mmio_write(SPI0_CS, 0);
+}
 
-    // Write byte
+uint8_t spi_transfer(uint8_t v) {
     mmio_write(SPI0_FIFO, v);
+    while (!(mmio_read(SPI0_CS) & SPI0_CS_RXD)) { }
+    return (uint8_t)mmio_read(SPI0_FIFO);
+}
+
+// ------------------------------------------------------------
+// DMA transactions
+// ------------------------------------------------------------
+
+// Whole cache lines each: the maintenance on them must not reach
+// whatever the linker puts next
+#define DMA_BUF_SIZE(n) (((n) + CACHE_LINE - 1) & ~(CACHE_LINE - 1))
+
+// TX stream: one header word (DLEN + CS bits) followed by the bytes
+static uint32_t dma_tx_buf[DMA_BUF_SIZE(4 + SPI_DMA_MAX) / 4] __attribute__((aligned(CACHE_LINE)));
+static uint8_t dma_rx_buf[DMA_BUF_SIZE(SPI_DMA_MAX)] __attribute__((aligned(CACHE_LINE)));
+static dma_cb_t cb_tx, cb_rx;
+
+static spi_done_fn dma_done;
+static void *dma_ctx;
+static uint32_t dma_len;
+static volatile bool dma_active = false;
 
-    // Wait for done
-    while (!(mmio_read(SPI0_CS) & (1 << 16))) { } // DONE
+static void spi_dma_complete(uint32_t ch, bool error, void *ctx) {
+    dcache_invalidate_range(dma_rx_buf, sizeof(dma_rx_buf));
+    mmio_write(SPI0_CS, 0);     // leave DMA mode, TA already dropped by ADCS
 
-    uint8_t r = (uint8_t)mmio_read(SPI0_FIFO);
-    spi_end();
-    return r;
+    if (error)
+        dma_abort(DMA_CH_SPI_TX);
+
+    dma_active = false;
+    if (dma_done)
+        dma_done(dma_rx_buf, dma_len, dma_ctx);
 }
 
-// If you want explicit CS control via GPIO instead of HW CS:
-void spi_cs_low(void) {
-    // e.g. use GPIO8 as manual CS if desired
-    // gpio_write(8, 0);
+bool spi_xfer_async(const uint8_t *tx, uint32_t len, spi_done_fn done, void *ctx) {
+    if (dma_active || len == 0 || len > SPI_DMA_MAX)
+        return false;
+
+    uint32_t padded = (len + 3) & ~3u;
+    uint8_t *bytes = (uint8_t *)&dma_tx_buf[1];
+
+    dma_tx_buf[0] = (padded << 16) | SPI0_CS_TA;
+    for (uint32_t i = 0; i < padded; i++)
+        bytes[i] = i < len && tx ? tx[i] : 0;
+
+    dma_active = true;
+    dma_done = done;
+    dma_ctx = ctx;
+    dma_len = len;
+
+    dcache_clean_range(dma_tx_buf, sizeof(dma_tx_buf));
+    dcache_clean_invalidate_range(dma_rx_buf, sizeof(dma_rx_buf));
+
+    uint32_t fifo = dma_periph_bus_addr(SPI0_FIFO);
+
+    cb_tx.ti = DMA_TI_SRC_INC | DMA_TI_DEST_DREQ | DMA_TI_WAIT_RESP |
+               DMA_TI_PERMAP(DMA_DREQ_SPI_TX);
+    cb_tx.source_ad = dma_bus_addr(dma_tx_buf);
+    cb_tx.dest_ad = fifo;
+    cb_tx.txfr_len = 4 + padded;
+    cb_tx.stride = 0;
+    dma_cb_chain(&cb_tx, 0);
+
+    cb_rx.ti = DMA_TI_DEST_INC | DMA_TI_SRC_DREQ | DMA_TI_INTEN |
+               DMA_TI_PERMAP(DMA_DREQ_SPI_RX);
+    cb_rx.source_ad = fifo;
+    cb_rx.dest_ad = dma_bus_addr(dma_rx_buf);
+    cb_rx.txfr_len = padded;
+    cb_rx.stride = 0;
+    dma_cb_chain(&cb_rx, 0);
+
+    // DMA mode: the header word loads DLEN and sets TA, ADCS drops CS at the end
+    mmio_write(SPI0_CS, SPI0_CS_CLEAR | SPI0_CS_DMAEN | SPI0_CS_ADCS);
+
+    // RX first so no received word is missed
+    dma_start(DMA_CH_SPI_RX, &cb_rx, 1, spi_dma_complete, 0);
+    dma_start(DMA_CH_SPI_TX, &cb_tx, 1, 0, 0);
+    return true;
 }
 
-void spi_cs_high(void) {
-    // gpio_write(8, 1);
+bool spi_busy(void) {
+    return dma_active;
+}
+
+// Polled transactions must not interleave with a DMA one. Callers run
+// with IRQs masked, so the completion is polled here rather than waited for
+static void spi_wait_idle(void) {
+    while (dma_active)
+        dma_poll();
+}
+
+void spi_xfer(const uint8_t *tx, uint8_t *rx, uint32_t len) {
+    uint32_t txn = 0, rxn = 0;
+
+    spi_cs_low();
+
+    // Keep the TX FIFO topped up while draining RX, never letting more
+    // than a FIFO's worth be in flight so RX cannot overflow
+    while (rxn < len) {
+        uint32_t cs = mmio_read(SPI0_CS);
+
+        while (txn < len && (txn - rxn) < SPI_FIFO_DEPTH && (cs & SPI0_CS_TXD)) {
+            mmio_write(SPI0_FIFO, tx ? tx[txn] : 0);
+            txn++;
+            cs = mmio_read(SPI0_CS);
+        }
+
+        while (rxn < txn && (cs & SPI0_CS_RXD)) {
+            uint8_t v = (uint8_t)mmio_read(SPI0_FIFO);
+            if (rx)
+                rx[rxn] = v;
+            rxn++;
+            cs = mmio_read(SPI0_CS);
+        }
+    }
+
+    spi_cs_high();
 }
@@ -0,0 +1,112 @@
+#include "tasks.h"
+#include "doorbell.h"
+#include "fb_tiles.h"
+#include "irq.h"
+#include "smp.h"
+#include "sync.h"
+#include "timer.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Written by the owning core only; other cores read the idle time
+static struct {
+    task_t *head;
+    uint64_t idle_us;
+    uint64_t asleep_since;      // 0 while awake
+} cores[SMP_NUM_CORES];
+
+void task_add(task_t *t, uint32_t core) {
+    task_t *head = sync_load_rlx(&cores[core].head);
+
+    t->core = core;
+    t->due = 0;
+    t->woken = 0;
+    do {
+        t->next = head;
+    } while (!sync_cas(&cores[core].head, &head, t));
+
+    doorbell_ring(core, DOORBELL_WAKE);
+}
+
+void task_wake(task_t *t) {
+    sync_store_rel(&t->woken, 1);
+    doorbell_ring(t->core, DOORBELL_WAKE);
+}
+
+// The bell only has to wake the core: the pass after it finds the work
+static void doorbell_irq(uint32_t irq, void *ctx) {
+    doorbell_take(smp_core_id());
+}
+
+// Run every task that is due; returns when the next one is
+static uint64_t run_due(task_t *t, uint64_t now, bool irq) {
+    uint64_t next = TASK_IDLE;
+
+    for (; t; t = t->next) {
+        bool woken = sync_load_rlx(&t->woken) && sync_xchg(&t->woken, 0);
+
+        if (woken || now >= t->due || (irq && t->on_irq))
+            t->due = t->fn(now, t->ctx);
+        if (t->due < next)
+            next = t->due;
+    }
+    return next;
+}
+
+// IRQs stay masked from the last check to the WFI, so one that arrives
+// in between is left pending and ends the WFI at once. seen is the IRQ
+// count the pass started with: anything taken since may have made a
+// task runnable.
+static void sleep_until(uint32_t core, uint64_t until, uint32_t seen) {
+    uint64_t daif = irq_save();
+    uint64_t now = timer_get_counter();
+
+    if (irq_taken() == seen && now < until) {
+        if (until != TASK_IDLE)
+            timer_wake_at(until);
+        else
+            timer_wake_cancel();
+
+        sync_store_rlx(&cores[core].asleep_since, now);
+        irq_wait();
+
+        uint64_t slept = timer_get_counter() - now;
+        sync_store_rlx(&cores[core].asleep_since, 0);
+        sync_store_rlx(&cores[core].idle_us, cores[core].idle_us + slept);
+    }
+    irq_restore(daif);
+}
+
+void tasks_run(void) {
+    uint32_t core = smp_core_id();
+    uint32_t seen = irq_taken();
+
+    irq_register(IRQ_DOORBELL, doorbell_irq, 0);
+    irq_enable(IRQ_DOORBELL);
+    irq_cpu_enable();
+
+    for (;;) {
+        uint32_t taken = irq_taken();
+        bool irq = taken != seen;
+        seen = taken;
+
+        uint64_t next = run_due(sync_load_acq(&cores[core].head),
+                                timer_get_counter(), irq);
+
+        // One band per pass, so a due task waits no longer than a band
+        if (fb_tiles_help())
+            continue;
+
+        sleep_until(core, next, seen);
+    }
+}
+
+uint64_t tasks_idle_us(uint32_t core, uint64_t now) {
+    uint64_t since = sync_load_rlx(&cores[core].asleep_since);
+    uint64_t idle = sync_load_rlx(&cores[core].idle_us);
+
+    // Count a sleep still in progress
+    if (since && now > since)
+        idle += now - since;
+    return idle;
+}
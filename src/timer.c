@@ -1,11 +1,31 @@
 #include "peripherals.h"
 #include "timer.h"
+#include "irq.h"
+#include "smp.h"
+#include <stdbool.h>
 
 #define SYS_TIMER_CLO  (TIMER_BASE + 0x04)
 #define SYS_TIMER_CHI  (TIMER_BASE + 0x08)
 
+// Shorter delays spin: arming the core timer and waking from WFI cost
+// about as much
+#define SPIN_MAX_US    20
+// Longer wakes are cut short (the caller sleeps again), keeping the
+// tick conversion inside 64 bits
+#define WAKE_MAX_US    60000000u
+
+static uint64_t cnt_freq;       // core timer ticks per second
+static bool wake_irq_on[SMP_NUM_CORES];
+
+// Level-triggered: off until the next timer_wake_at()
+static void wake_irq(uint32_t irq, void *ctx) {
+    timer_wake_cancel();
+}
+
 void timer_init(void) {
     // System timer needs no configuration
+    __asm__ volatile("mrs %0, cntfrq_el0" : "=r"(cnt_freq));
+    irq_register(IRQ_CNTPNS, wake_irq, 0);
 }
 
 uint64_t timer_get_counter(void) {
@@ -18,8 +38,54 @@ uint64_t timer_get_counter(void) {
     return ((uint64_t)hi << 32) | lo;
 }
 
+void timer_wake_at(uint64_t us) {
+    uint32_t core = smp_core_id();
+    uint64_t now = timer_get_counter();
+    uint64_t dt = us > now ? us - now : 0;
+    uint64_t cnt;
+
+    // WFI only ends for IRQs the local controller passes to the core
+    if (!wake_irq_on[core]) {
+        irq_enable(IRQ_CNTPNS);
+        wake_irq_on[core] = true;
+    }
+
+    if (dt > WAKE_MAX_US)
+        dt = WAKE_MAX_US;
+
+    __asm__ volatile("mrs %0, cntpct_el0" : "=r"(cnt));
+    cnt += (dt * cnt_freq + 999999) / 1000000;
+
+    __asm__ volatile("msr cntp_cval_el0, %0\n"
+                     "msr cntp_ctl_el0, %1\n"
+                     "isb" :: "r"(cnt), "r"((uint64_t)1) : "memory");
+}
+
+void timer_wake_cancel(void) {
+    __asm__ volatile("msr cntp_ctl_el0, xzr\n"
+                     "isb" ::: "memory");
+}
+
 void timer_delay_us(uint32_t us) {
-    uint64_t start = timer_get_counter();
-    uint64_t target = start + us;
+    uint64_t target = timer_get_counter() + us;
+
+    // Masked from the check to the WFI, or the wake could be taken just
+    // before it; restored after each wake so pending handlers run
+    while (us > SPIN_MAX_US) {
+        uint64_t daif = irq_save();
+        bool done = timer_get_counter() >= target;
+
+        if (!done) {
+            timer_wake_at(target);
+            irq_wait();
+        }
+        irq_restore(daif);
+
+        if (done) {
+            timer_wake_cancel();
+            return;
+        }
+    }
+
     while (timer_get_counter() < target) { }
 }
@@ -8,8 +8,12 @@
 #define UART0_FBRD  (UART0_BASE + 0x28)
 #define UART0_LCRH  (UART0_BASE + 0x2C)
 #define UART0_CR    (UART0_BASE + 0x30)
+#define UART0_IMSC  (UART0_BASE + 0x38)
 #define UART0_ICR   (UART0_BASE + 0x44)
 
+#define UART0_INT_RX    (1 << 4)
+#define UART0_INT_RT    (1 << 6)    // receive timeout: data below the FIFO level
+
 void uart_init(void) {
     mmio_write(UART0_CR, 0x00000000);
 
@@ -39,3 +43,17 @@ void uart_puts(const char *s) {
         uart_putc(*s++);
     }
 }
+
+bool uart_getc(char *c) {
+    if (mmio_read(UART0_FR) & (1 << 4))     // RXFE
+        return false;
+
+    *c = (char)(mmio_read(UART0_DR) & 0xFF);
+    return true;
+}
+
+void uart_rx_irq(bool on) {
+    if (on)
+        mmio_write(UART0_ICR, UART0_INT_RX | UART0_INT_RT);
+    mmio_write(UART0_IMSC, on ? UART0_INT_RX | UART0_INT_RT : 0);
+}
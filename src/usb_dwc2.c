@@ -12,6 +12,7 @@
 #define USB_HFIR        (USB_BASE + 0x404)
 #define USB_HPRT        (USB_BASE + 0x440)
 #define USB_HCCHAR(n)   (USB_BASE + 0x500 + (n)*0x20)
+#define USB_HCINT(n)    (USB_BASE + 0x508 + (n)*0x20)
 #define USB_HCTSIZ(n)   (USB_BASE + 0x510 + (n)*0x20)
 #define USB_HCDMA(n)    (USB_BASE + 0x514 + (n)*0x20)
 
@@ -124,13 +125,28 @@ int dwc2_intr_in(uint8_t ep, uint8_t *buf, uint16_t len) {
 #define HC_NUM_BULK   1
 #define HC_NUM_INTR   2
 
-// Simple polling wait for channel done (very bare-metal, no IRQs yet)
+// HCINT bits
+#define HCINT_XFERCOMPL (1 << 0)
+#define HCINT_CHHLTD    (1 << 1)
+#define HCINT_ERRORS    ((1 << 2) | (1 << 3) | (1 << 7) | (1 << 8) | (1 << 9) | (1 << 10))
+
+#define HC_WAIT_US      2000
+#define HC_POLL_US      100
+
+// Polled wait for channel done (no USB IRQ yet), asleep between reads.
+// A channel that has not reported back after HC_WAIT_US has failed.
 static bool dwc2_wait_channel_done(int ch) {
-    // In a full implementation you'd watch HCINT/HCINTMSK.
-    // Here we just spin a bit and assume success if no obvious error.
-    // This is crude but good enough to get you talking to one device.
-    timer_delay_us(2000);
-    return true;
+    uint64_t deadline = timer_get_counter() + HC_WAIT_US;
+    uint32_t hcint;
+
+    while (!((hcint = mmio_read(USB_HCINT(ch))) & (HCINT_XFERCOMPL | HCINT_CHHLTD))) {
+        if (timer_get_counter() >= deadline)
+            return false;
+        timer_delay_us(HC_POLL_US);
+    }
+
+    mmio_write(USB_HCINT(ch), hcint);       // write-1-to-clear
+    return !(hcint & HCINT_ERRORS);
 }
 
 bool dwc2_ctrl_stage_setup(const uint8_t setup[8]) {
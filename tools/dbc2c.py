@@ -0,0 +1,257 @@
+#!/usr/bin/env python3
+"""
+Compile a DBC file into the const signal tables used by src/can_signals.c.
+
+    tools/dbc2c.py dbc/dash.dbc src/can_db.c include/can_db.h
+
+Every signal is reduced to a word select (Intel or Motorola), a shift and a
+mask into the frame's 64-bit payload, plus an integer scale so the target
+decodes without floating point. Values are produced in 1/SIG_SCALE units.
+
+Message lookup uses a perfect hash found here at build time (hash and
+displace over two multiplicative hashes), collision-free over the DB's IDs.
+"""
+
+import random
+import re
+import sys
+from fractions import Fraction
+
+SIG_SCALE = 1000            # must match can_signals.h
+INT32_MIN = -(1 << 31)
+INT32_MAX = (1 << 31) - 1
+
+BO_RE = re.compile(r'^BO_\s+(\d+)\s+(\w+)\s*:\s*(\d+)\s+(\w+)')
+SG_RE = re.compile(
+    r'^SG_\s+(\w+)\s*(\w+)?\s*:\s*(\d+)\|(\d+)@([01])([+-])\s*'
+    r'\(\s*([^,]+),\s*([^)]+)\)\s*\[\s*([^|]+)\|([^\]]+)\]\s*"([^"]*)"')
+
+
+class Signal:
+    def __init__(self, name, start, length, motorola, signed,
+                 factor, offset, lo, hi, unit):
+        self.name = name
+        self.length = length
+        self.motorola = motorola
+        self.signed = signed
+        self.unit = unit
+
+        if motorola:
+            # DBC start bit is the MSB in sawtooth numbering; in the
+            # big-endian payload word byte b bit k sits at (7 - b) * 8 + k
+            msb = (7 - start // 8) * 8 + start % 8
+            self.shift = msb - length + 1
+        else:
+            self.shift = start
+        if self.shift < 0 or self.shift + length > 64:
+            raise ValueError('signal %s does not fit in 8 bytes' % name)
+
+        scale = Fraction(factor) * SIG_SCALE
+        scale = scale.limit_denominator(1 << 16)
+        self.num = scale.numerator
+        self.den = scale.denominator
+        self.offset = round(Fraction(offset) * SIG_SCALE)
+
+        lo = round(Fraction(lo) * SIG_SCALE)
+        hi = round(Fraction(hi) * SIG_SCALE)
+        if lo == 0 and hi == 0:
+            # [0|0] means "no range given"
+            lo, hi = INT32_MIN, INT32_MAX
+        self.min = max(lo, INT32_MIN)
+        self.max = min(hi, INT32_MAX)
+
+
+class Message:
+    def __init__(self, dbc_id, name, dlc):
+        self.name = name
+        self.dlc = dlc
+        # DBC marks 29-bit IDs with bit 31, same as CAN_EFF_FLAG
+        self.id = dbc_id
+        self.signals = []
+
+
+def parse(path):
+    msgs = []
+    cur = None
+    with open(path) as f:
+        for lineno, line in enumerate(f, 1):
+            line = line.strip()
+            m = BO_RE.match(line)
+            if m:
+                cur = Message(int(m.group(1)), m.group(2), int(m.group(3)))
+                msgs.append(cur)
+                continue
+            m = SG_RE.match(line)
+            if m:
+                if cur is None:
+                    raise SystemExit('%s:%d: SG_ outside BO_' % (path, lineno))
+                if m.group(2):
+                    print('%s:%d: skipping multiplexed signal %s'
+                          % (path, lineno, m.group(1)), file=sys.stderr)
+                    continue
+                cur.signals.append(Signal(
+                    m.group(1), int(m.group(3)), int(m.group(4)),
+                    m.group(5) == '0', m.group(6) == '-',
+                    m.group(7).strip(), m.group(8).strip(),
+                    m.group(9).strip(), m.group(10).strip(), m.group(11)))
+                continue
+            if line.startswith('BO_') or line.startswith('SG_'):
+                raise SystemExit('%s:%d: cannot parse: %s' % (path, lineno, line))
+    return [m for m in msgs if m.signals]
+
+
+def c_int(v):
+    if v == INT32_MIN:
+        return 'INT32_MIN'
+    if v == INT32_MAX:
+        return 'INT32_MAX'
+    return str(v)
+
+
+def c_ident(s):
+    return re.sub(r'(?<=[a-z0-9])(?=[A-Z])', '_', s).upper()
+
+
+def mul_hash(key, mult, bits):
+    return ((key * mult) & 0xFFFFFFFF) >> (32 - bits)
+
+
+def perfect_hash(ids):
+    """Hash-and-displace: IDs are split into buckets by one multiplicative
+    hash, then each bucket gets a displacement that moves all of its keys
+    onto free slots of a power-of-two table under a second hash. Lookup is
+    two multiplies and one displacement load, with no collisions."""
+    bits = max(1, (len(ids) - 1).bit_length())
+    bucket_bits = max(1, bits - 1)
+    size = 1 << bits
+    rng = random.Random(0x2515)         # deterministic output
+
+    for _ in range(1000):
+        m1 = rng.getrandbits(32) | 1
+        m2 = rng.getrandbits(32) | 1
+        buckets = [[] for _ in range(1 << bucket_bits)]
+        for i in ids:
+            buckets[mul_hash(i, m1, bucket_bits)].append(i)
+
+        used = [False] * size
+        disp = [0] * len(buckets)
+        order = sorted(range(len(buckets)), key=lambda b: -len(buckets[b]))
+        for b in order:
+            keys = buckets[b]
+            if not keys:
+                continue
+            for d in range(size):
+                slots = {(mul_hash(k, m2, bits) + d) & (size - 1) for k in keys}
+                if len(slots) == len(keys) and not any(used[x] for x in slots):
+                    for x in slots:
+                        used[x] = True
+                    disp[b] = d
+                    break
+            else:
+                break
+        else:
+            return bits, bucket_bits, m1, m2, disp
+    raise SystemExit('no perfect hash found for %d IDs' % len(ids))
+
+
+def hash_slot(key, bits, bucket_bits, m1, m2, disp):
+    d = disp[mul_hash(key, m1, bucket_bits)]
+    return (mul_hash(key, m2, bits) + d) & ((1 << bits) - 1)
+
+
+def emit(msgs, src, c_path, h_path):
+    banner = '// Generated by tools/dbc2c.py from %s -- do not edit\n' % src
+
+    h = [banner, '#pragma once\n', '#include "can_signals.h"\n', '\n',
+         '// Message IDs in can_frame_t encoding\n']
+    for m in msgs:
+        h.append('#define CAN_MSG_%s 0x%08Xu\n' % (c_ident(m.name), m.id))
+    h.append('\n// Slots in sig_values[], in 1/SIG_SCALE of the unit shown\n')
+    h.append('enum {\n')
+    names = ['SIG_%s_%s,' % (c_ident(m.name), c_ident(s.name))
+             for m in msgs for s in m.signals]
+    units = [s.unit for m in msgs for s in m.signals]
+    width = max(len(n) for n in names)
+    for n, u in zip(names, units):
+        h.append(('    %-*s  // %s' % (width, n, u)).rstrip() + '\n')
+    h.append('    SIG_COUNT\n};\n\n')
+    ids = [m.id for m in msgs]
+    if len(set(ids)) != len(ids):
+        raise SystemExit('duplicate message IDs in %s' % src)
+    bits, bucket_bits, m1, m2, disp = perfect_hash(ids)
+    slot_type = 'uint8_t' if len(msgs) < 0xFF else 'uint16_t'
+    empty = 0xFF if slot_type == 'uint8_t' else 0xFFFF
+
+    h.append('#define CAN_DB_NUM_MESSAGES %d\n\n' % len(msgs))
+    disp_type = 'uint8_t' if len(disp) <= 0x100 and (1 << bits) <= 0x100 else 'uint16_t'
+    h.append('// Perfect hash, see can_db_find():\n')
+    h.append('//   b    = (id * MULT1) >> (32 - BUCKET_BITS)\n')
+    h.append('//   slot = ((id * MULT2) >> (32 - BITS)) + disp[b], mod 2^BITS\n')
+    h.append('#define CAN_DB_HASH_BITS        %d\n' % bits)
+    h.append('#define CAN_DB_HASH_BUCKET_BITS %d\n' % bucket_bits)
+    h.append('#define CAN_DB_HASH_MULT1       0x%08Xu\n' % m1)
+    h.append('#define CAN_DB_HASH_MULT2       0x%08Xu\n' % m2)
+    h.append('#define CAN_DB_HASH_EMPTY       0x%X\n' % empty)
+    h.append('typedef %s can_db_slot_t;\n' % slot_type)
+    h.append('typedef %s can_db_disp_t;\n\n' % disp_type)
+    h.append('extern const can_msg_def_t can_db_messages[CAN_DB_NUM_MESSAGES];\n')
+    h.append('extern const can_signal_t can_db_signals[SIG_COUNT];\n')
+    h.append('extern const can_db_disp_t can_db_hash_disp[1 << CAN_DB_HASH_BUCKET_BITS];\n')
+    h.append('extern const can_db_slot_t can_db_hash[1 << CAN_DB_HASH_BITS];\n')
+
+    c = [banner, '#include "can_db.h"\n', '\n',
+         'const can_signal_t can_db_signals[SIG_COUNT] = {\n',
+         '    //  shift, len, flags, num, den, offset, min, max\n']
+    for m in msgs:
+        for s in m.signals:
+            flags = []
+            if s.motorola:
+                flags.append('SIG_BIG_ENDIAN')
+            if s.signed:
+                flags.append('SIG_SIGNED')
+            c.append('    [SIG_%s_%s] = { %d, %d, %s, %d, %d, %d, %s, %s },\n' % (
+                c_ident(m.name), c_ident(s.name), s.shift, s.length,
+                ' | '.join(flags) or '0',
+                s.num, s.den, s.offset, c_int(s.min), c_int(s.max)))
+    c.append('};\n\n')
+
+    c.append('const can_msg_def_t can_db_messages[CAN_DB_NUM_MESSAGES] = {\n')
+    c.append('    //  id, dlc, first signal, signal count\n')
+    for m in msgs:
+        c.append('    { CAN_MSG_%s, %d, SIG_%s_%s, %d },\n' % (
+            c_ident(m.name), m.dlc, c_ident(m.name),
+            c_ident(m.signals[0].name), len(m.signals)))
+    c.append('};\n\n')
+    table = [empty] * (1 << bits)
+    for n, m in enumerate(msgs):
+        table[hash_slot(m.id, bits, bucket_bits, m1, m2, disp)] = n
+
+    c.append('const can_db_disp_t can_db_hash_disp[1 << CAN_DB_HASH_BUCKET_BITS] = {\n')
+    for i in range(0, len(disp), 8):
+        c.append('    %s,\n' % ', '.join(str(v) for v in disp[i:i + 8]))
+    c.append('};\n\n')
+
+    c.append('const can_db_slot_t can_db_hash[1 << CAN_DB_HASH_BITS] = {\n')
+    for i in range(0, len(table), 8):
+        c.append('    %s,\n' % ', '.join(
+            'CAN_DB_HASH_EMPTY' if v == empty else str(v)
+            for v in table[i:i + 8]))
+    c.append('};\n\n')
+
+    c.append('int32_t sig_values[SIG_COUNT];\n')
+
+    with open(h_path, 'w') as f:
+        f.writelines(h)
+    with open(c_path, 'w') as f:
+        f.writelines(c)
+
+
+def main():
+    if len(sys.argv) != 4:
+        raise SystemExit('usage: dbc2c.py input.dbc out.c out.h')
+    msgs = parse(sys.argv[1])
+    emit(msgs, sys.argv[1], sys.argv[2], sys.argv[3])
+
+
+if __name__ == '__main__':
+    main()